@@ -0,0 +1,182 @@
+#include "Batch.h"
+#include "Count.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+
+
+namespace l1 {
+    namespace {
+        // A task keeps taking files until it has this many bytes or files,
+        // which keeps per-task overhead small next to the reading itself.
+        const std::size_t BYTES_PER_TASK = std::size_t(8) << 20;
+        const std::size_t FILES_PER_TASK = 256;
+
+        const std::size_t READ_BUFFER_SIZE = std::size_t(1) << 20;
+
+        struct Found {
+            std::string path;
+            std::size_t size;
+        };
+
+
+        void walk(
+            const std::filesystem::path& directory, std::vector<Found>& found
+        ) {
+            const std::size_t first = found.size();
+            std::error_code ec;
+            std::filesystem::recursive_directory_iterator it(
+                directory,
+                std::filesystem::directory_options::skip_permission_denied,
+                ec
+            );
+
+            const std::filesystem::recursive_directory_iterator end;
+            for (; !ec && it != end; it.increment(ec)) {
+                std::error_code entry_ec;
+                if (it->is_regular_file(entry_ec)) {
+                    const std::uintmax_t size = it->file_size(entry_ec);
+                    found.push_back({it->path().string(), entry_ec ? 0 : size});
+                }
+            }
+
+            // Directory order is arbitrary; sorting keeps the output stable.
+            std::sort(
+                found.begin() + first,
+                found.end(),
+                [](const Found& a, const Found& b) { return a.path < b.path; }
+            );
+        }
+
+
+        void add(const std::string& path, std::vector<Found>& found) {
+            std::error_code ec;
+            if (std::filesystem::is_directory(path, ec)) {
+                walk(path, found);
+
+                return;
+            }
+
+            // Files that cannot be examined are still listed, so that they
+            // show up as failed in the results.
+            const std::uintmax_t size = std::filesystem::file_size(path, ec);
+            found.push_back({path, ec ? 0 : size});
+        }
+
+
+        std::vector<Found> expand(const std::vector<std::string>& inputs) {
+            std::vector<Found> found;
+
+            for (const std::string& input: inputs) {
+                if (input.find_first_of("*?[") == std::string::npos) {
+                    add(input, found);
+                    continue;
+                }
+
+                glob_t matches;
+                if (::glob(input.c_str(), 0, nullptr, &matches) == 0) {
+                    for (std::size_t i = 0; i < matches.gl_pathc; ++i) {
+                        add(matches.gl_pathv[i], found);
+                    }
+                }
+                ::globfree(&matches);
+            }
+
+            return found;
+        }
+
+
+        void count_file(FileCount& result, char* buffer) {
+            const int fd = ::open(result.path.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd == -1) {
+                return;
+            }
+
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+            while (true) {
+                const ssize_t n = ::read(fd, buffer, READ_BUFFER_SIZE);
+                if (n > 0) {
+                    result.lines += count_newlines(buffer, n);
+                    result.chars += n;
+                } else if (n == 0) {
+                    result.ok = true;
+                    break;
+                } else if (errno != EINTR) {
+                    break;
+                }
+            }
+
+            ::close(fd);
+        }
+
+
+        void count_range(
+            std::vector<FileCount>& files, std::size_t begin, std::size_t end
+        ) {
+            thread_local std::unique_ptr<char[]> buffer(
+                new char[READ_BUFFER_SIZE]
+            );
+
+            for (std::size_t i = begin; i < end; ++i) {
+                count_file(files[i], buffer.get());
+            }
+        }
+    }
+
+
+    BatchCount count_files(
+        const std::vector<std::string>& inputs, ThreadPool& pool
+    ) {
+        std::vector<Found> found = expand(inputs);
+
+        BatchCount count;
+        count.files.resize(found.size());
+        for (std::size_t i = 0; i < found.size(); ++i) {
+            count.files[i].path = std::move(found[i].path);
+        }
+
+        // Every task owns a distinct range of 'count.files', so the workers
+        // never touch the same result.
+        for (std::size_t begin = 0; begin < found.size(); ) {
+            std::size_t end = begin;
+            std::size_t bytes = 0;
+            while (
+                end < found.size()
+                && end - begin < FILES_PER_TASK
+                && (end == begin || bytes + found[end].size <= BYTES_PER_TASK)
+            ) {
+                bytes += found[end++].size;
+            }
+
+            pool.submit([&files = count.files, begin, end]() {
+                count_range(files, begin, end);
+            });
+            begin = end;
+        }
+
+        pool.wait();
+
+        for (const FileCount& file: count.files) {
+            count.lines += file.lines;
+            count.chars += file.chars;
+            count.failed += !file.ok;
+        }
+
+        return count;
+    }
+
+
+    BatchCount count_files(const std::vector<std::string>& inputs) {
+        ThreadPool pool;
+
+        return count_files(inputs, pool);
+    }
+}
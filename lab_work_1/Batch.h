@@ -0,0 +1,37 @@
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+
+
+namespace l1 {
+    struct FileCount {
+        std::string path;
+        std::size_t lines = 0;
+        std::size_t chars = 0;
+        bool ok = false;
+    };
+
+    struct BatchCount {
+        std::vector<FileCount> files;
+        std::size_t lines = 0;
+        std::size_t chars = 0;
+        std::size_t failed = 0;
+    };
+
+    // Counts the lines and chars of every file named by 'inputs', the way
+    // Txt does. An input may be a file, a directory (walked recursively) or
+    // a glob pattern. Small files are grouped into one task per batch, and
+    // every worker reads through a single buffer of its own, so a file costs
+    // no heap allocations once it has been found.
+    BatchCount count_files(
+        const std::vector<std::string>& inputs, ThreadPool& pool
+    );
+
+    BatchCount count_files(const std::vector<std::string>& inputs);
+}
+
+#endif // BATCH_H_INCLUDED
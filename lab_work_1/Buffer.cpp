@@ -0,0 +1,226 @@
+#include "Buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace l1 {
+    namespace {
+        // What new char[] guarantees, which the scanning code relies on no
+        // more than any other allocation.
+        const std::size_t ALIGNMENT = alignof(std::max_align_t);
+
+        // The first read from a file of unknown size.
+        const std::size_t READ_CHUNK = std::size_t(64) << 10;
+    }
+
+
+    Buffer::Buffer(
+        char* data,
+        std::size_t size,
+        std::size_t capacity,
+        bool mapped,
+        std::pmr::memory_resource* resource
+    )
+        : _data(data),
+          _size(size),
+          _capacity(capacity),
+          _mapped(mapped),
+          _resource(resource) {}
+
+
+    std::shared_ptr<Buffer> Buffer::read(
+        const std::string& filename, std::pmr::memory_resource* resource
+    ) {
+        std::ifstream file(filename);
+
+        if (!file.is_open()) {
+            return nullptr;
+        }
+
+        file.seekg(0, std::ios_base::end);
+
+        const std::streamoff end = file.tellg();
+        if (end == -1) {
+            // Pipes and character devices have no end to seek to; they are
+            // read until they run out, into a buffer that doubles as it
+            // fills up.
+            file.clear();
+
+            std::shared_ptr<Buffer> buffer = Buffer::allocate(
+                0, READ_CHUNK, resource
+            );
+            while (file) {
+                if (buffer->_size == buffer->_capacity) {
+                    buffer = Buffer::copy(
+                        buffer->_data,
+                        buffer->_size,
+                        2 * buffer->_capacity,
+                        resource
+                    );
+                }
+
+                file.read(
+                    buffer->_data + buffer->_size,
+                    buffer->_capacity - buffer->_size
+                );
+                buffer->_size += file.gcount();
+            }
+
+            return buffer;
+        }
+
+        const std::size_t size = end;
+        std::shared_ptr<Buffer> buffer = Buffer::allocate(
+            size, size, resource
+        );
+
+        file.seekg(0, std::ios_base::beg);
+
+        file.read(buffer->_data, size);
+
+        file.close();
+
+        return buffer;
+    }
+
+
+    std::shared_ptr<Buffer> Buffer::map(
+        const std::string& filename, std::size_t scan_from
+    ) {
+        const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd == -1) {
+            return nullptr;
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) == -1 || !S_ISREG(info.st_mode)) {
+            ::close(fd);
+
+            return nullptr;
+        }
+
+        // mmap() refuses zero-length mappings; an empty file simply has no
+        // content, exactly like an empty file that was read.
+        if (info.st_size == 0) {
+            ::close(fd);
+
+            return std::shared_ptr<Buffer>(
+                new Buffer(nullptr, 0, 0, false, nullptr)
+            );
+        }
+
+        const std::size_t size = info.st_size;
+        void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        // The mapping keeps its own reference to the file.
+        ::close(fd);
+
+        if (address == MAP_FAILED) {
+            return nullptr;
+        }
+
+        // The content is scanned front to back right away, so ask for
+        // aggressive read-ahead and for the pages to be brought in early.
+        // madvise() wants a page-aligned start.
+        const std::size_t page = ::sysconf(_SC_PAGESIZE);
+        const std::size_t advised = std::min(scan_from, size) / page * page;
+        char* start = static_cast<char*>(address) + advised;
+        ::madvise(start, size - advised, MADV_SEQUENTIAL);
+        ::madvise(start, size - advised, MADV_WILLNEED);
+
+        return std::shared_ptr<Buffer>(
+            new Buffer(static_cast<char*>(address), size, size, true, nullptr)
+        );
+    }
+
+
+    std::shared_ptr<Buffer> Buffer::allocate(
+        std::size_t size,
+        std::size_t capacity,
+        std::pmr::memory_resource* resource
+    ) {
+        capacity = std::max(size, capacity);
+        if (!resource) {
+            resource = std::pmr::get_default_resource();
+        }
+
+        char* data = static_cast<char*>(
+            resource->allocate(capacity, ALIGNMENT)
+        );
+
+        return std::shared_ptr<Buffer>(
+            new Buffer(data, size, capacity, false, resource)
+        );
+    }
+
+
+    std::shared_ptr<Buffer> Buffer::copy(
+        const char* data,
+        std::size_t size,
+        std::size_t capacity,
+        std::pmr::memory_resource* resource
+    ) {
+        std::shared_ptr<Buffer> buffer = Buffer::allocate(
+            size, capacity, resource
+        );
+        if (size) {
+            std::memcpy(buffer->_data, data, size);
+        }
+
+        return buffer;
+    }
+
+
+    Buffer::~Buffer() {
+        if (this->_mapped) {
+            ::munmap(this->_data, this->_size);
+        } else if (this->_resource) {
+            this->_resource->deallocate(
+                this->_data, this->_capacity, ALIGNMENT
+            );
+        }
+    }
+
+
+    const char* Buffer::data() const {
+        return this->_data;
+    }
+
+
+    char* Buffer::data() {
+        return this->_data;
+    }
+
+
+    std::size_t Buffer::size() const {
+        return this->_size;
+    }
+
+
+    std::size_t Buffer::capacity() const {
+        return this->_capacity;
+    }
+
+
+    bool Buffer::mapped() const {
+        return this->_mapped;
+    }
+
+
+    void Buffer::resize(std::size_t size) {
+        if (this->_mapped || size > this->_capacity) {
+            throw std::length_error("Buffer cannot be resized to this size");
+        }
+
+        this->_size = size;
+    }
+}
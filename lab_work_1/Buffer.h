@@ -0,0 +1,75 @@
+#ifndef BUFFER_H_INCLUDED
+#define BUFFER_H_INCLUDED
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+
+
+namespace l1 {
+    // The bytes of a file, either copied into the heap or mapped read-only.
+    // Txt objects share one Buffer between copies and treat it as immutable
+    // while it is shared; only the sole owner of a heap buffer may write.
+    //
+    // Heap buffers come from a std::pmr::memory_resource, the default one
+    // unless another is given, which must outlive the buffer.
+    class Buffer {
+    private:
+        char* _data;
+        std::size_t _size;
+        std::size_t _capacity;
+        bool _mapped;
+        std::pmr::memory_resource* _resource;
+
+        Buffer(
+            char* data,
+            std::size_t size,
+            std::size_t capacity,
+            bool mapped,
+            std::pmr::memory_resource* resource
+        );
+
+    public:
+        // Both return nullptr when the file cannot be opened. map() also
+        // returns nullptr for files that cannot be mapped, such as pipes,
+        // which read() reads in chunks until they end.
+        // Only the part of the mapping from 'scan_from' on is advised for
+        // read-ahead, since that is the part about to be scanned.
+        static std::shared_ptr<Buffer> read(
+            const std::string& filename,
+            std::pmr::memory_resource* resource = nullptr
+        );
+        static std::shared_ptr<Buffer> map(
+            const std::string& filename, std::size_t scan_from = 0
+        );
+
+        // A heap buffer of 'size' bytes with room to grow to 'capacity'.
+        static std::shared_ptr<Buffer> allocate(
+            std::size_t size,
+            std::size_t capacity,
+            std::pmr::memory_resource* resource = nullptr
+        );
+        static std::shared_ptr<Buffer> copy(
+            const char* data,
+            std::size_t size,
+            std::size_t capacity = 0,
+            std::pmr::memory_resource* resource = nullptr
+        );
+
+        Buffer(const Buffer& other) = delete;
+        Buffer& operator=(const Buffer& other) = delete;
+
+        ~Buffer();
+
+        const char* data() const;
+        char* data();
+        std::size_t size() const;
+        std::size_t capacity() const;
+        bool mapped() const;
+
+        // Only heap buffers can be resized, and never beyond capacity().
+        void resize(std::size_t size);
+    };
+}
+
+#endif // BUFFER_H_INCLUDED
@@ -0,0 +1,123 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+
+
+namespace l1 {
+    namespace {
+        const std::size_t SMALLEST_CLASS = 12;
+
+        // Blocks are handed out again for any request of their class, so
+        // they are all allocated with the strictest alignment served.
+        const std::size_t BLOCK_ALIGNMENT = 64;
+
+
+        // The size class of a request: the exponent of the power of two it
+        // is rounded up to, counted from 4 KiB.
+        std::size_t size_class(std::size_t bytes) {
+            std::size_t exponent = SMALLEST_CLASS;
+            while ((std::size_t(1) << exponent) < bytes) {
+                ++exponent;
+            }
+
+            return exponent - SMALLEST_CLASS;
+        }
+
+
+        std::size_t class_size(std::size_t index) {
+            return std::size_t(1) << (index + SMALLEST_CLASS);
+        }
+    }
+
+
+    BufferPool::BufferPool(
+        std::size_t largest,
+        std::size_t max_cached,
+        std::pmr::memory_resource* upstream
+    )
+        : _largest(largest),
+          _max_cached(max_cached),
+          _upstream(upstream),
+          _free(size_class(largest) + 1),
+          _cached(0) {}
+
+
+    BufferPool::~BufferPool() {
+        this->release();
+    }
+
+
+    std::size_t BufferPool::cached() {
+        std::lock_guard lock(this->_m);
+
+        return this->_cached;
+    }
+
+
+    void BufferPool::release() {
+        std::lock_guard lock(this->_m);
+
+        for (std::size_t index = 0; index < this->_free.size(); ++index) {
+            for (void* block: this->_free[index]) {
+                this->_upstream->deallocate(
+                    block, class_size(index), BLOCK_ALIGNMENT
+                );
+            }
+            this->_free[index].clear();
+        }
+        this->_cached = 0;
+    }
+
+
+    void* BufferPool::do_allocate(std::size_t bytes, std::size_t alignment) {
+        if (bytes > this->_largest || alignment > BLOCK_ALIGNMENT) {
+            return this->_upstream->allocate(bytes, alignment);
+        }
+
+        const std::size_t index = size_class(bytes);
+        {
+            std::lock_guard lock(this->_m);
+            std::vector<void*>& blocks = this->_free[index];
+            if (!blocks.empty()) {
+                void* block = blocks.back();
+                blocks.pop_back();
+                this->_cached -= class_size(index);
+
+                return block;
+            }
+        }
+
+        return this->_upstream->allocate(class_size(index), BLOCK_ALIGNMENT);
+    }
+
+
+    void BufferPool::do_deallocate(
+        void* p, std::size_t bytes, std::size_t alignment
+    ) {
+        if (bytes > this->_largest || alignment > BLOCK_ALIGNMENT) {
+            this->_upstream->deallocate(p, bytes, alignment);
+
+            return;
+        }
+
+        const std::size_t index = size_class(bytes);
+        {
+            std::lock_guard lock(this->_m);
+            if (this->_cached + class_size(index) <= this->_max_cached) {
+                this->_free[index].push_back(p);
+                this->_cached += class_size(index);
+
+                return;
+            }
+        }
+
+        this->_upstream->deallocate(p, class_size(index), BLOCK_ALIGNMENT);
+    }
+
+
+    bool BufferPool::do_is_equal(
+        const std::pmr::memory_resource& other
+    ) const noexcept {
+        return this == &other;
+    }
+}
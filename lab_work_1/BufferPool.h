@@ -0,0 +1,60 @@
+#ifndef BUFFER_POOL_H_INCLUDED
+#define BUFFER_POOL_H_INCLUDED
+
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+
+namespace l1 {
+    // A memory resource that keeps freed blocks for reuse instead of giving
+    // them back, for jobs that load and drop many files of similar sizes.
+    // Requests are rounded up to a power of two (4 KiB at least), and each
+    // of those size classes has a list of free blocks. Requests bigger than
+    // 'largest', and blocks that would push the cache past 'max_cached'
+    // bytes, go straight to and from 'upstream'. Safe to share between
+    // threads.
+    //
+    // For loads that are all freed together, std::pmr::monotonic_buffer_
+    // resource does the same job with no bookkeeping at all.
+    class BufferPool : public std::pmr::memory_resource {
+    private:
+        std::size_t _largest;
+        std::size_t _max_cached;
+        std::pmr::memory_resource* _upstream;
+
+        std::mutex _m;
+        std::vector<std::vector<void*>> _free;
+        std::size_t _cached;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(
+            void* p, std::size_t bytes, std::size_t alignment
+        ) override;
+        bool do_is_equal(
+            const std::pmr::memory_resource& other
+        ) const noexcept override;
+
+    public:
+        static const std::size_t DEFAULT_LARGEST = std::size_t(64) << 20;
+        static const std::size_t DEFAULT_MAX_CACHED = std::size_t(256) << 20;
+
+        explicit BufferPool(
+            std::size_t largest = DEFAULT_LARGEST,
+            std::size_t max_cached = DEFAULT_MAX_CACHED,
+            std::pmr::memory_resource* upstream =
+                std::pmr::get_default_resource()
+        );
+        BufferPool(const BufferPool& other) = delete;
+        BufferPool& operator=(const BufferPool& other) = delete;
+        ~BufferPool();
+
+        // Bytes held in free blocks.
+        std::size_t cached();
+
+        // Gives every free block back to the upstream resource.
+        void release();
+    };
+}
+
+#endif // BUFFER_POOL_H_INCLUDED
@@ -0,0 +1,183 @@
+#include "Count.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define L1_X86 1
+#endif
+
+
+namespace l1 {
+    namespace {
+        // Below this many bytes per thread, starting a thread costs more
+        // than it saves.
+        const std::size_t MIN_BYTES_PER_THREAD = std::size_t(8) << 20;
+
+        using Kernel = std::size_t (*)(const char*, std::size_t);
+
+
+        std::size_t count_scalar(const char* data, std::size_t length) {
+            std::size_t count = 0;
+            for (std::size_t i = 0; i < length; ++i) {
+                count += data[i] == '\n';
+            }
+
+            return count;
+        }
+
+
+#ifdef L1_X86
+        // The vector kernels subtract the all-ones compare masks from byte
+        // counters, so every lane counts up to 255 matches before the
+        // counters have to be folded into 64-bit sums with SAD.
+        __attribute__((target("sse2")))
+        std::size_t count_sse2(const char* data, std::size_t length) {
+            const __m128i newline = _mm_set1_epi8('\n');
+            const __m128i zero = _mm_setzero_si128();
+            __m128i total = zero;
+            std::size_t i = 0;
+
+            while (length - i >= 16) {
+                const std::size_t blocks = std::min<std::size_t>(
+                    (length - i) / 16, 255
+                );
+                __m128i counters = zero;
+                for (std::size_t b = 0; b < blocks; ++b, i += 16) {
+                    const __m128i chunk = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(data + i)
+                    );
+                    counters = _mm_sub_epi8(
+                        counters, _mm_cmpeq_epi8(chunk, newline)
+                    );
+                }
+                total = _mm_add_epi64(total, _mm_sad_epu8(counters, zero));
+            }
+
+            alignas(16) std::uint64_t lanes[2];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), total);
+
+            return lanes[0] + lanes[1] + count_scalar(data + i, length - i);
+        }
+
+
+        __attribute__((target("avx2")))
+        std::size_t count_avx2(const char* data, std::size_t length) {
+            const __m256i newline = _mm256_set1_epi8('\n');
+            const __m256i zero = _mm256_setzero_si256();
+            __m256i total = zero;
+            std::size_t i = 0;
+
+            while (length - i >= 32) {
+                const std::size_t blocks = std::min<std::size_t>(
+                    (length - i) / 32, 255
+                );
+                __m256i counters = zero;
+                for (std::size_t b = 0; b < blocks; ++b, i += 32) {
+                    const __m256i chunk = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(data + i)
+                    );
+                    counters = _mm256_sub_epi8(
+                        counters, _mm256_cmpeq_epi8(chunk, newline)
+                    );
+                }
+                total = _mm256_add_epi64(
+                    total, _mm256_sad_epu8(counters, zero)
+                );
+            }
+
+            alignas(32) std::uint64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+
+            return lanes[0] + lanes[1] + lanes[2] + lanes[3]
+                + count_scalar(data + i, length - i);
+        }
+
+
+        __attribute__((target("avx512f,avx512bw,popcnt")))
+        std::size_t count_avx512(const char* data, std::size_t length) {
+            const __m512i newline = _mm512_set1_epi8('\n');
+            std::size_t count = 0;
+            std::size_t i = 0;
+
+            for (; length - i >= 64; i += 64) {
+                const __m512i chunk = _mm512_loadu_si512(data + i);
+                count += _mm_popcnt_u64(
+                    _mm512_cmpeq_epi8_mask(chunk, newline)
+                );
+            }
+
+            return count + count_scalar(data + i, length - i);
+        }
+#endif
+
+
+        Kernel select_kernel() {
+#ifdef L1_X86
+            __builtin_cpu_init();
+            if (
+                __builtin_cpu_supports("avx512bw")
+                && __builtin_cpu_supports("popcnt")
+            ) {
+                return count_avx512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return count_avx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return count_sse2;
+            }
+#endif
+            return count_scalar;
+        }
+    }
+
+
+    std::size_t count_newlines(const char* data, std::size_t length) {
+        static const Kernel kernel = select_kernel();
+
+        // Asking for the number of cores costs more than counting a small
+        // buffer, and small buffers come often, e.g. between search matches.
+        if (length < 2 * MIN_BYTES_PER_THREAD) {
+            return kernel(data, length);
+        }
+
+        const std::size_t threads = std::min<std::size_t>(
+            std::max(std::thread::hardware_concurrency(), 1u),
+            length / MIN_BYTES_PER_THREAD
+        );
+
+        if (threads <= 1) {
+            return kernel(data, length);
+        }
+
+        // The calling thread takes the last chunk instead of idling in join.
+        const std::size_t chunk = length / threads;
+        std::vector<std::size_t> counts(threads);
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+
+        for (std::size_t t = 0; t + 1 < threads; ++t) {
+            workers.emplace_back([&counts, data, chunk, t]() {
+                counts[t] = kernel(data + t * chunk, chunk);
+            });
+        }
+
+        const std::size_t tail = (threads - 1) * chunk;
+        counts[threads - 1] = kernel(data + tail, length - tail);
+
+        for (auto& worker: workers) {
+            worker.join();
+        }
+
+        std::size_t count = 0;
+        for (const std::size_t c: counts) {
+            count += c;
+        }
+
+        return count;
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef COUNT_H_INCLUDED
+#define COUNT_H_INCLUDED
+
+#include <cstddef>
+
+
+namespace l1 {
+    // Counts the '\n' bytes in [data, data + length). The kernel is picked
+    // once at run time from the widest instruction set the CPU supports, and
+    // large buffers are split into chunks that are counted on several cores.
+    std::size_t count_newlines(const char* data, std::size_t length);
+}
+
+#endif // COUNT_H_INCLUDED
@@ -0,0 +1,163 @@
+#include "Follower.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+
+namespace l1 {
+    namespace {
+        const std::uint32_t FILE_EVENTS = IN_MODIFY | IN_ATTRIB
+            | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+        const std::uint32_t DIRECTORY_EVENTS = IN_CREATE | IN_MOVED_TO
+            | IN_MOVED_FROM | IN_DELETE;
+
+        // The watched inode is gone from under the name being followed.
+        const std::uint32_t FILE_GONE = IN_MOVE_SELF | IN_DELETE_SELF
+            | IN_IGNORED;
+    }
+
+
+    Follower::Follower(Txt& txt)
+        : _txt(txt),
+          _inotify(-1),
+          _wakeup(-1),
+          _file_watch(-1),
+          _directory_watch(-1) {
+        const std::filesystem::path path(txt.filename());
+        std::filesystem::path directory = path.parent_path();
+        if (directory.empty()) {
+            directory = ".";
+        }
+        this->_name = path.filename().string();
+
+        this->_inotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        this->_wakeup = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (this->_inotify == -1 || this->_wakeup == -1) {
+            const int error = errno;
+            if (this->_inotify != -1) {
+                ::close(this->_inotify);
+            }
+            if (this->_wakeup != -1) {
+                ::close(this->_wakeup);
+            }
+            throw std::system_error(error, std::generic_category(), "inotify");
+        }
+
+        this->_directory_watch = ::inotify_add_watch(
+            this->_inotify, directory.c_str(), DIRECTORY_EVENTS
+        );
+        if (this->_directory_watch == -1) {
+            const int error = errno;
+            ::close(this->_inotify);
+            ::close(this->_wakeup);
+            throw std::system_error(
+                error, std::generic_category(), "inotify_add_watch"
+            );
+        }
+        this->_watch_file();
+    }
+
+
+    Follower::~Follower() {
+        if (this->_inotify != -1) {
+            ::close(this->_inotify);
+        }
+        if (this->_wakeup != -1) {
+            ::close(this->_wakeup);
+        }
+    }
+
+
+    void Follower::run(const Callback& callback) {
+        // The file may have changed before the watches were in place.
+        const Refresh initial = this->_txt.refresh();
+        if (initial != Refresh::UNCHANGED) {
+            callback(this->_txt, initial);
+        }
+
+        alignas(inotify_event) char events[4096];
+        pollfd fds[2] = {
+            {this->_inotify, POLLIN, 0},
+            {this->_wakeup, POLLIN, 0}
+        };
+
+        while (true) {
+            if (::poll(fds, 2, -1) == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "poll");
+            }
+
+            if (fds[1].revents) {
+                std::uint64_t value;
+                ::read(this->_wakeup, &value, sizeof(value));
+
+                return;
+            }
+
+            // Drain every queued event first, so a burst of writes costs a
+            // single refresh.
+            bool relevant = false;
+            bool rewatch = false;
+            ssize_t n;
+            while ((n = ::read(this->_inotify, events, sizeof(events))) > 0) {
+                for (char* p = events; p < events + n; ) {
+                    const inotify_event* event =
+                        reinterpret_cast<const inotify_event*>(p);
+                    p += sizeof(inotify_event) + event->len;
+
+                    if (event->wd == this->_file_watch) {
+                        relevant = true;
+                        rewatch |= (event->mask & FILE_GONE) != 0;
+                    } else if (
+                        event->wd == this->_directory_watch
+                        && event->len
+                        && this->_name == event->name
+                    ) {
+                        relevant = true;
+                        rewatch = true;
+                    }
+                }
+            }
+
+            if (rewatch) {
+                this->_watch_file();
+            }
+
+            if (relevant) {
+                const Refresh refresh = this->_txt.refresh();
+                if (refresh != Refresh::UNCHANGED) {
+                    callback(this->_txt, refresh);
+                }
+            }
+        }
+    }
+
+
+    void Follower::stop() {
+        const std::uint64_t value = 1;
+        ::write(this->_wakeup, &value, sizeof(value));
+    }
+
+
+    void Follower::_watch_file() {
+        // A watch follows the inode, so after rotation the old one is
+        // dropped and the new file under the same name is watched instead.
+        if (this->_file_watch != -1) {
+            ::inotify_rm_watch(this->_inotify, this->_file_watch);
+        }
+
+        this->_file_watch = ::inotify_add_watch(
+            this->_inotify, this->_txt.filename().c_str(), FILE_EVENTS
+        );
+    }
+}
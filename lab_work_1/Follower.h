@@ -0,0 +1,47 @@
+#ifndef FOLLOWER_H_INCLUDED
+#define FOLLOWER_H_INCLUDED
+
+#include <functional>
+#include <string>
+
+#include "Txt.h"
+
+
+namespace l1 {
+    // Keeps a Txt up to date with its file, like 'tail -F'. The file and
+    // its directory are watched with inotify, so the follower sleeps until
+    // the kernel reports a change and then calls Txt::refresh(). Watching
+    // the directory lets it pick the file up again after rotation.
+    class Follower {
+    public:
+        using Callback = std::function<void(const Txt& txt, Refresh refresh)>;
+
+    private:
+        Txt& _txt;
+        std::string _name;
+        int _inotify;
+        int _wakeup;
+        int _file_watch;
+        int _directory_watch;
+
+        void _watch_file();
+
+    public:
+        // Throws std::system_error if inotify cannot be set up.
+        explicit Follower(Txt& txt);
+
+        Follower(const Follower& other) = delete;
+        Follower& operator=(const Follower& other) = delete;
+
+        ~Follower();
+
+        // Blocks, calling 'callback' after every refresh that found
+        // something, until stop() is called.
+        void run(const Callback& callback);
+
+        // May be called from any thread, including from the callback.
+        void stop();
+    };
+}
+
+#endif // FOLLOWER_H_INCLUDED
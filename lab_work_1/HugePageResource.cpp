@@ -0,0 +1,102 @@
+#include "HugePageResource.h"
+
+#include <cstdint>
+#include <new>
+
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26)
+#endif
+
+
+namespace l1 {
+    namespace {
+        std::size_t round_up(std::size_t bytes) {
+            const std::size_t page = HugePageResource::HUGE_PAGE_SIZE;
+
+            return (bytes + page - 1) / page * page;
+        }
+    }
+
+
+    HugePageResource::HugePageResource(
+        std::size_t threshold, std::pmr::memory_resource* upstream
+    )
+        : _threshold(threshold),
+          _upstream(upstream) {}
+
+
+    void* HugePageResource::do_allocate(
+        std::size_t bytes, std::size_t alignment
+    ) {
+        if (bytes < this->_threshold || alignment > HUGE_PAGE_SIZE) {
+            return this->_upstream->allocate(bytes, alignment);
+        }
+
+        const std::size_t size = round_up(bytes);
+
+        void* address = ::mmap(
+            nullptr,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+            -1,
+            0
+        );
+        if (address != MAP_FAILED) {
+            return address;
+        }
+
+        // Transparent huge pages only back 2 MiB-aligned ranges, so map a
+        // page more than needed and cut off the misaligned ends.
+        address = ::mmap(
+            nullptr,
+            size + HUGE_PAGE_SIZE,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0
+        );
+        if (address == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        char* start = static_cast<char*>(address);
+        char* aligned = reinterpret_cast<char*>(
+            (reinterpret_cast<std::uintptr_t>(start) + HUGE_PAGE_SIZE - 1)
+                / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE
+        );
+        if (aligned != start) {
+            ::munmap(start, aligned - start);
+        }
+        const std::size_t after = HUGE_PAGE_SIZE - (aligned - start);
+        if (after) {
+            ::munmap(aligned + size, after);
+        }
+
+        ::madvise(aligned, size, MADV_HUGEPAGE);
+
+        return aligned;
+    }
+
+
+    void HugePageResource::do_deallocate(
+        void* p, std::size_t bytes, std::size_t alignment
+    ) {
+        if (bytes < this->_threshold || alignment > HUGE_PAGE_SIZE) {
+            this->_upstream->deallocate(p, bytes, alignment);
+
+            return;
+        }
+
+        ::munmap(p, round_up(bytes));
+    }
+
+
+    bool HugePageResource::do_is_equal(
+        const std::pmr::memory_resource& other
+    ) const noexcept {
+        return this == &other;
+    }
+}
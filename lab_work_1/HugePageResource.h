@@ -0,0 +1,38 @@
+#ifndef HUGE_PAGE_RESOURCE_H_INCLUDED
+#define HUGE_PAGE_RESOURCE_H_INCLUDED
+
+#include <memory_resource>
+
+
+namespace l1 {
+    // A memory resource that backs large blocks with 2 MiB pages, so that
+    // scanning a big buffer takes a TLB miss every 2 MiB rather than every
+    // 4 KiB. Explicit huge pages (MAP_HUGETLB) are used when the system has
+    // some reserved; otherwise the block is aligned to 2 MiB and offered to
+    // transparent huge pages with madvise(). Requests under 'threshold'
+    // bytes go to 'upstream'.
+    class HugePageResource : public std::pmr::memory_resource {
+    private:
+        std::size_t _threshold;
+        std::pmr::memory_resource* _upstream;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(
+            void* p, std::size_t bytes, std::size_t alignment
+        ) override;
+        bool do_is_equal(
+            const std::pmr::memory_resource& other
+        ) const noexcept override;
+
+    public:
+        static const std::size_t HUGE_PAGE_SIZE = std::size_t(2) << 20;
+
+        explicit HugePageResource(
+            std::size_t threshold = 4 * HUGE_PAGE_SIZE,
+            std::pmr::memory_resource* upstream =
+                std::pmr::get_default_resource()
+        );
+    };
+}
+
+#endif // HUGE_PAGE_RESOURCE_H_INCLUDED
@@ -0,0 +1,327 @@
+#include "LineCheckpoints.h"
+#include "Count.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include <unistd.h>
+
+
+namespace l1 {
+    namespace {
+        const std::size_t MIN_BYTES_PER_THREAD = std::size_t(8) << 20;
+
+        const std::size_t HASHED_BYTES = 4096;
+
+        // The windows of a stride that its fingerprint hashes.
+        const std::size_t SAMPLES = 16;
+        const std::size_t SAMPLE_BYTES = 64;
+
+        // The first 8 bytes of a sidecar; the last one is the format version.
+        const char MAGIC[8] = {'L', '1', 'L', 'I', 'D', 'X', '\0', '\2'};
+
+        // Bounds the counts read from a corrupt sidecar before they are
+        // allocated.
+        const std::uint64_t MAX_COUNTS = std::uint64_t(1) << 32;
+
+
+        // FNV-1a: not strong, but only meant to catch files that changed
+        // by accident, not on purpose.
+        std::uint64_t hash(
+            const char* data,
+            std::size_t length,
+            std::uint64_t h = 14695981039346656037ull
+        ) {
+            for (std::size_t i = 0; i < length; ++i) {
+                h ^= static_cast<unsigned char>(data[i]);
+                h *= 1099511628211ull;
+            }
+
+            return h;
+        }
+
+
+        std::uint64_t head_hash(const char* data, std::size_t length) {
+            return hash(data, std::min(length, HASHED_BYTES));
+        }
+
+
+        std::uint64_t tail_hash(const char* data, std::size_t length) {
+            const std::size_t hashed = std::min(length, HASHED_BYTES);
+
+            return hash(data + length - hashed, hashed);
+        }
+
+
+        // The first and the last windows are always among the ones hashed.
+        std::uint64_t fingerprint(const char* data, std::size_t stride) {
+            if (stride <= SAMPLES * SAMPLE_BYTES) {
+                return hash(data, stride);
+            }
+
+            const std::size_t step = (stride - SAMPLE_BYTES) / (SAMPLES - 1);
+            std::uint64_t h = hash(data, SAMPLE_BYTES);
+            for (std::size_t s = 1; s + 1 < SAMPLES; ++s) {
+                h = hash(data + s * step, SAMPLE_BYTES, h);
+            }
+
+            return hash(data + stride - SAMPLE_BYTES, SAMPLE_BYTES, h);
+        }
+
+
+        // The lines in each of 'strides' strides from data on, counted in
+        // parallel when there are enough of them.
+        std::vector<std::uint64_t> count_strides(
+            const char* data, std::size_t strides, std::size_t stride
+        ) {
+            const std::size_t threads = std::max<std::size_t>(
+                std::min<std::size_t>(
+                    std::max(std::thread::hardware_concurrency(), 1u),
+                    strides * stride / MIN_BYTES_PER_THREAD
+                ),
+                1
+            );
+
+            std::vector<std::uint64_t> counts(strides);
+            const auto count = [&counts, data, stride](
+                std::size_t first, std::size_t last
+            ) {
+                for (std::size_t s = first; s < last; ++s) {
+                    counts[s] = count_newlines(data + s * stride, stride);
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for (std::size_t t = 0; t + 1 < threads; ++t) {
+                workers.emplace_back(
+                    count, strides / threads * t, strides / threads * (t + 1)
+                );
+            }
+            count(strides / threads * (threads - 1), strides);
+            for (auto& worker: workers) {
+                worker.join();
+            }
+
+            return counts;
+        }
+
+
+        void put(std::ofstream& file, std::uint64_t value) {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+
+        bool get(std::ifstream& file, std::uint64_t& value) {
+            return bool(
+                file.read(reinterpret_cast<char*>(&value), sizeof(value))
+            );
+        }
+    }
+
+
+    LineCheckpoints::LineCheckpoints(std::size_t stride)
+        : _stride(std::max<std::size_t>(stride, 1)),
+          _length(0),
+          _lines(0),
+          _inode(0),
+          _modified(0),
+          _head_hash(0),
+          _tail_hash(0) {}
+
+
+    void LineCheckpoints::extend(const char* data, std::size_t to) {
+        // First the stride the last scan stopped in; every one after it is
+        // whole and is counted on its own, so they can go in parallel.
+        std::size_t at = this->_length;
+        const std::size_t boundary = (this->_counts.size() + 1) * this->_stride;
+        if (boundary > to) {
+            this->_lines += count_newlines(data + at, to - at);
+            this->_length = to;
+
+            return;
+        }
+
+        this->_lines += count_newlines(data + at, boundary - at);
+        this->_counts.push_back(this->_lines);
+        this->_fingerprints.push_back(
+            fingerprint(data + boundary - this->_stride, this->_stride)
+        );
+        at = boundary;
+
+        const std::size_t strides = (to - at) / this->_stride;
+        const std::vector<std::uint64_t> counts = count_strides(
+            data + at, strides, this->_stride
+        );
+
+        for (std::size_t s = 0; s < strides; ++s) {
+            this->_lines += counts[s];
+            this->_counts.push_back(this->_lines);
+            this->_fingerprints.push_back(
+                fingerprint(data + at + s * this->_stride, this->_stride)
+            );
+        }
+        at += strides * this->_stride;
+
+        this->_lines += count_newlines(data + at, to - at);
+        this->_length = to;
+    }
+
+
+    std::size_t LineCheckpoints::length() const {
+        return this->_length;
+    }
+
+
+    std::size_t LineCheckpoints::lines() const {
+        return this->_lines;
+    }
+
+
+    std::uint64_t LineCheckpoints::inode() const {
+        return this->_inode;
+    }
+
+
+    std::int64_t LineCheckpoints::modified() const {
+        return this->_modified;
+    }
+
+
+    bool LineCheckpoints::is_prefix_of(
+        const char* data, std::size_t length
+    ) const {
+        return length >= this->_length
+            && head_hash(data, this->_length) == this->_head_hash
+            && tail_hash(data, this->_length) == this->_tail_hash;
+    }
+
+
+    void LineCheckpoints::verify(const char* data) {
+        std::size_t kept = 0;
+        while (
+            kept < this->_fingerprints.size()
+            && fingerprint(data + kept * this->_stride, this->_stride)
+                == this->_fingerprints[kept]
+        ) {
+            ++kept;
+        }
+
+        this->_counts.resize(kept);
+        this->_fingerprints.resize(kept);
+        this->_length = kept * this->_stride;
+        this->_lines = kept > 0 ? this->_counts[kept - 1] : 0;
+    }
+
+
+    bool LineCheckpoints::load(const std::string& filename) {
+        std::ifstream file(sidecar_of(filename), std::ios_base::binary);
+
+        char magic[sizeof(MAGIC)];
+        if (
+            !file.read(magic, sizeof(magic))
+            || !std::equal(magic, magic + sizeof(magic), MAGIC)
+        ) {
+            return false;
+        }
+
+        std::uint64_t fields[8];
+        for (std::uint64_t& field: fields) {
+            if (!get(file, field)) {
+                return false;
+            }
+        }
+
+        const std::uint64_t stride = fields[0];
+        const std::uint64_t length = fields[1];
+        const std::uint64_t number_of_counts = fields[7];
+        if (
+            stride == 0
+            || number_of_counts > MAX_COUNTS
+            || number_of_counts != length / stride
+        ) {
+            return false;
+        }
+
+        // Each count is followed by the fingerprint of its stride.
+        std::vector<std::uint64_t> counts(number_of_counts);
+        std::vector<std::uint64_t> fingerprints(number_of_counts);
+        for (std::size_t k = 0; k < number_of_counts; ++k) {
+            if (!get(file, counts[k]) || !get(file, fingerprints[k])) {
+                return false;
+            }
+        }
+
+        this->_stride = stride;
+        this->_length = length;
+        this->_lines = fields[2];
+        this->_inode = fields[3];
+        this->_modified = std::int64_t(fields[4]);
+        this->_head_hash = fields[5];
+        this->_tail_hash = fields[6];
+        this->_counts = std::move(counts);
+        this->_fingerprints = std::move(fingerprints);
+
+        return true;
+    }
+
+
+    bool LineCheckpoints::save(
+        const std::string& filename,
+        const char* data,
+        std::uint64_t inode,
+        std::int64_t modified
+    ) {
+        this->_inode = inode;
+        this->_modified = modified;
+        this->_head_hash = head_hash(data, this->_length);
+        this->_tail_hash = tail_hash(data, this->_length);
+
+        // Written aside and renamed into place, so that a reader never sees
+        // half a sidecar.
+        const std::string sidecar = sidecar_of(filename);
+        const std::string temporary =
+            sidecar + "." + std::to_string(::getpid()) + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios_base::binary);
+            if (!file.is_open()) {
+                return false;
+            }
+
+            file.write(MAGIC, sizeof(MAGIC));
+            put(file, this->_stride);
+            put(file, this->_length);
+            put(file, this->_lines);
+            put(file, this->_inode);
+            put(file, std::uint64_t(this->_modified));
+            put(file, this->_head_hash);
+            put(file, this->_tail_hash);
+            put(file, this->_counts.size());
+            for (std::size_t k = 0; k < this->_counts.size(); ++k) {
+                put(file, this->_counts[k]);
+                put(file, this->_fingerprints[k]);
+            }
+
+            if (!file.flush()) {
+                file.close();
+                std::remove(temporary.c_str());
+
+                return false;
+            }
+        }
+
+        if (std::rename(temporary.c_str(), sidecar.c_str()) != 0) {
+            std::remove(temporary.c_str());
+
+            return false;
+        }
+
+        return true;
+    }
+
+
+    std::string LineCheckpoints::sidecar_of(const std::string& filename) {
+        return filename + ".lidx";
+    }
+}
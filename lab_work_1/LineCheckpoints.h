@@ -0,0 +1,73 @@
+#ifndef LINE_CHECKPOINTS_H_INCLUDED
+#define LINE_CHECKPOINTS_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace l1 {
+    // The number of lines before every multiple of a stride of bytes, for
+    // the first length() bytes of a file. Unlike LineIndex it is small
+    // enough to keep on disk next to the file, in "<file>.lidx", so that a
+    // file can be opened again without being scanned again.
+    //
+    // A saved sidecar is recognized by the inode of the file, and by hashes
+    // of its first and last 4 KiB, which tell a file that was only appended
+    // to from one that was rewritten. If the modification time changed too,
+    // the hashes are not enough, since an edit in the middle keeps them:
+    // every stride also has a fingerprint, a hash of 16 windows of 64 bytes
+    // spread over it, which verify() checks without reading the rest. Bytes
+    // inserted or removed shift the windows of the strides after them and
+    // are caught; bytes overwritten in place between two windows are not.
+    class LineCheckpoints {
+    private:
+        std::size_t _stride;
+        std::size_t _length;
+        std::size_t _lines;
+        std::vector<std::uint64_t> _counts;
+        std::vector<std::uint64_t> _fingerprints;
+        std::uint64_t _inode;
+        std::int64_t _modified;
+        std::uint64_t _head_hash;
+        std::uint64_t _tail_hash;
+
+    public:
+        static const std::size_t DEFAULT_STRIDE = std::size_t(1) << 20;
+
+        explicit LineCheckpoints(std::size_t stride = DEFAULT_STRIDE);
+
+        // Counts the lines of data[length(), to), adding a checkpoint at
+        // every stride boundary on the way.
+        void extend(const char* data, std::size_t to);
+
+        std::size_t length() const;
+        std::size_t lines() const;
+
+        // What the file was when the checkpoints were saved or loaded.
+        std::uint64_t inode() const;
+        std::int64_t modified() const;
+
+        // Whether data[0, length) starts with the bytes that were counted,
+        // as far as the hashes of their first and last 4 KiB can tell.
+        bool is_prefix_of(const char* data, std::size_t length) const;
+
+        // Keeps the checkpoints up to the first stride of data whose
+        // fingerprint differs. data must hold length() bytes at least.
+        void verify(const char* data);
+
+        // Both return false instead of throwing: the sidecar only saves
+        // time, so a missing, corrupt or unwritable one is no error.
+        bool load(const std::string& filename);
+        bool save(
+            const std::string& filename,
+            const char* data,
+            std::uint64_t inode,
+            std::int64_t modified
+        );
+
+        static std::string sidecar_of(const std::string& filename);
+    };
+}
+
+#endif // LINE_CHECKPOINTS_H_INCLUDED
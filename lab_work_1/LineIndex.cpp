@@ -0,0 +1,174 @@
+#include "LineIndex.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define L1_X86 1
+#endif
+
+
+namespace l1 {
+    namespace {
+        template<class Offset>
+        void collect_scalar(
+            const char* data,
+            std::size_t begin,
+            std::size_t end,
+            std::vector<Offset>& starts
+        ) {
+            for (std::size_t i = begin; i < end; ++i) {
+                if (data[i] == '\n') {
+                    starts.push_back(Offset(i + 1));
+                }
+            }
+        }
+
+
+#ifdef L1_X86
+        // Both vector kernels turn a block compare into a bit mask and walk
+        // its set bits, so the cost follows the number of lines rather than
+        // the number of chars.
+        template<class Offset>
+        __attribute__((target("sse2")))
+        void collect_sse2(
+            const char* data,
+            std::size_t begin,
+            std::size_t end,
+            std::vector<Offset>& starts
+        ) {
+            const __m128i newline = _mm_set1_epi8('\n');
+            std::size_t i = begin;
+
+            for (; end - i >= 16; i += 16) {
+                const __m128i chunk = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(data + i)
+                );
+                unsigned mask = _mm_movemask_epi8(
+                    _mm_cmpeq_epi8(chunk, newline)
+                );
+                while (mask) {
+                    starts.push_back(Offset(i + __builtin_ctz(mask) + 1));
+                    mask &= mask - 1;
+                }
+            }
+
+            collect_scalar(data, i, end, starts);
+        }
+
+
+        template<class Offset>
+        __attribute__((target("avx2")))
+        void collect_avx2(
+            const char* data,
+            std::size_t begin,
+            std::size_t end,
+            std::vector<Offset>& starts
+        ) {
+            const __m256i newline = _mm256_set1_epi8('\n');
+            std::size_t i = begin;
+
+            for (; end - i >= 32; i += 32) {
+                const __m256i chunk = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(data + i)
+                );
+                unsigned mask = _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(chunk, newline)
+                );
+                while (mask) {
+                    starts.push_back(Offset(i + __builtin_ctz(mask) + 1));
+                    mask &= mask - 1;
+                }
+            }
+
+            collect_scalar(data, i, end, starts);
+        }
+#endif
+
+
+        template<class Offset>
+        void collect(
+            const char* data,
+            std::size_t begin,
+            std::size_t end,
+            std::vector<Offset>& starts
+        ) {
+#ifdef L1_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                collect_avx2(data, begin, end, starts);
+
+                return;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                collect_sse2(data, begin, end, starts);
+
+                return;
+            }
+#endif
+            collect_scalar(data, begin, end, starts);
+        }
+
+
+        bool needs_wide_offsets(std::size_t length) {
+            return length >= std::numeric_limits<std::uint32_t>::max();
+        }
+    }
+
+
+    LineIndex::LineIndex(const char* data, std::size_t length)
+        : _wide(needs_wide_offsets(length)) {
+        if (this->_wide) {
+            this->_wide_starts.push_back(0);
+            collect(data, 0, length, this->_wide_starts);
+            this->_wide_starts.shrink_to_fit();
+        } else {
+            this->_narrow_starts.push_back(0);
+            collect(data, 0, length, this->_narrow_starts);
+            this->_narrow_starts.shrink_to_fit();
+        }
+    }
+
+
+    void LineIndex::extend(const char* data, std::size_t from, std::size_t to) {
+        if (!this->_wide && needs_wide_offsets(to)) {
+            this->_wide_starts.assign(
+                this->_narrow_starts.begin(), this->_narrow_starts.end()
+            );
+            this->_narrow_starts = std::vector<std::uint32_t>();
+            this->_wide = true;
+        }
+
+        if (this->_wide) {
+            collect(data, from, to, this->_wide_starts);
+        } else {
+            collect(data, from, to, this->_narrow_starts);
+        }
+    }
+
+
+    std::size_t LineIndex::lines() const {
+        return this->_wide
+            ? this->_wide_starts.size() - 1
+            : this->_narrow_starts.size() - 1;
+    }
+
+
+    std::size_t LineIndex::start(std::size_t i) const {
+        return this->_wide ? this->_wide_starts[i] : this->_narrow_starts[i];
+    }
+
+
+    std::size_t LineIndex::line_of(std::size_t offset) const {
+        if (this->_wide) {
+            return std::upper_bound(
+                this->_wide_starts.begin(), this->_wide_starts.end(), offset
+            ) - this->_wide_starts.begin() - 1;
+        }
+
+        return std::upper_bound(
+            this->_narrow_starts.begin(), this->_narrow_starts.end(), offset
+        ) - this->_narrow_starts.begin() - 1;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef LINE_INDEX_H_INCLUDED
+#define LINE_INDEX_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+
+
+namespace l1 {
+    // Offsets of the first char of every line of a buffer, found in a single
+    // pass over it. Offsets are stored in 32 bits whenever the buffer is small
+    // enough for that, which halves the index for files under 4 GiB.
+    class LineIndex {
+    private:
+        std::vector<std::uint32_t> _narrow_starts;
+        std::vector<std::uint64_t> _wide_starts;
+        bool _wide;
+
+    public:
+        LineIndex(const char* data, std::size_t length);
+
+        // Adds the lines of data[from, to) to an index of data[0, from),
+        // for buffers that have grown since the index was built.
+        void extend(const char* data, std::size_t from, std::size_t to);
+
+        // The number of '\n' chars in the buffer.
+        std::size_t lines() const;
+
+        // Where line 'i' starts; start(lines()) is one past the last '\n'.
+        std::size_t start(std::size_t i) const;
+
+        // The line that the char at 'offset' belongs to.
+        std::size_t line_of(std::size_t offset) const;
+    };
+}
+
+#endif // LINE_INDEX_H_INCLUDED
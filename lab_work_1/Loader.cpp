@@ -0,0 +1,631 @@
+#include "Loader.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace l1 {
+    namespace {
+        const unsigned RING_ENTRIES = 64;
+
+        // A file has one request in the ring at a time, but the closes of
+        // finished files take room too.
+        const std::size_t FILES_IN_FLIGHT = RING_ENTRIES / 2;
+
+        // The length of a read request is 32 bits wide.
+        const std::size_t MAX_READ = std::size_t(1) << 30;
+
+        // The low bits of a request's user_data; the rest is its slot.
+        enum Operation : std::uint64_t {
+            OPEN,
+            READ,
+            CLOSE
+        };
+
+
+        // Just enough of io_uring for load_files(), on the raw system calls.
+        class Ring {
+        private:
+            int _fd;
+            void* _rings;
+            std::size_t _rings_size;
+            io_uring_sqe* _sqes;
+            std::size_t _sqes_size;
+
+            unsigned* _sq_tail;
+            unsigned* _sq_mask;
+            unsigned* _sq_array;
+            unsigned* _cq_head;
+            unsigned* _cq_tail;
+            unsigned* _cq_mask;
+            io_uring_cqe* _cqes;
+
+            // The submission queue tail as far as this side has filled it,
+            // and how many of those requests the kernel has yet to take.
+            unsigned _tail;
+            unsigned _unsubmitted;
+
+            bool _supports(const std::vector<int>& operations) const;
+
+        public:
+            explicit Ring(unsigned entries);
+            Ring(const Ring& other) = delete;
+            Ring& operator=(const Ring& other) = delete;
+            ~Ring();
+
+            // Whether the kernel has io_uring, with all that is needed.
+            bool ready() const;
+
+            // A cleared request at the tail of the submission queue; it is
+            // handed to the kernel by the next submit().
+            io_uring_sqe& prepare(std::uint64_t user_data);
+
+            // Submits the prepared requests and waits for 'wait_for' of the
+            // requests in flight to complete.
+            bool submit(unsigned wait_for);
+
+            bool complete(io_uring_cqe& cqe);
+        };
+
+
+        Ring::Ring(unsigned entries)
+            : _fd(-1),
+              _rings(MAP_FAILED),
+              _rings_size(0),
+              _sqes(static_cast<io_uring_sqe*>(MAP_FAILED)),
+              _sqes_size(0),
+              _tail(0),
+              _unsubmitted(0) {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            this->_fd = ::syscall(__NR_io_uring_setup, entries, &params);
+            if (this->_fd == -1) {
+                return;
+            }
+
+            // Kernels without a single mapping for both rings predate the
+            // operations used here anyway.
+            if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+                return;
+            }
+
+            this->_rings_size = std::max(
+                params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe)
+            );
+            this->_rings = ::mmap(
+                nullptr,
+                this->_rings_size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE,
+                this->_fd,
+                IORING_OFF_SQ_RING
+            );
+            if (this->_rings == MAP_FAILED) {
+                return;
+            }
+
+            this->_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            this->_sqes = static_cast<io_uring_sqe*>(::mmap(
+                nullptr,
+                this->_sqes_size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE,
+                this->_fd,
+                IORING_OFF_SQES
+            ));
+
+            char* rings = static_cast<char*>(this->_rings);
+            this->_sq_tail = reinterpret_cast<unsigned*>(
+                rings + params.sq_off.tail
+            );
+            this->_sq_mask = reinterpret_cast<unsigned*>(
+                rings + params.sq_off.ring_mask
+            );
+            this->_sq_array = reinterpret_cast<unsigned*>(
+                rings + params.sq_off.array
+            );
+            this->_cq_head = reinterpret_cast<unsigned*>(
+                rings + params.cq_off.head
+            );
+            this->_cq_tail = reinterpret_cast<unsigned*>(
+                rings + params.cq_off.tail
+            );
+            this->_cq_mask = reinterpret_cast<unsigned*>(
+                rings + params.cq_off.ring_mask
+            );
+            this->_cqes = reinterpret_cast<io_uring_cqe*>(
+                rings + params.cq_off.cqes
+            );
+            this->_tail = *this->_sq_tail;
+        }
+
+
+        Ring::~Ring() {
+            if (this->_sqes != MAP_FAILED) {
+                ::munmap(this->_sqes, this->_sqes_size);
+            }
+            if (this->_rings != MAP_FAILED) {
+                ::munmap(this->_rings, this->_rings_size);
+            }
+            if (this->_fd != -1) {
+                ::close(this->_fd);
+            }
+        }
+
+
+        bool Ring::_supports(const std::vector<int>& operations) const {
+            const unsigned listed = 256;
+            std::vector<char> memory(
+                sizeof(io_uring_probe) + listed * sizeof(io_uring_probe_op)
+            );
+            io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(
+                memory.data()
+            );
+
+            if (::syscall(
+                __NR_io_uring_register,
+                this->_fd,
+                IORING_REGISTER_PROBE,
+                probe,
+                listed
+            ) == -1) {
+                return false;
+            }
+
+            for (const int operation: operations) {
+                if (
+                    operation >= probe->ops_len
+                    || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)
+                ) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+
+        bool Ring::ready() const {
+            return this->_sqes != MAP_FAILED && this->_supports({
+                IORING_OP_OPENAT,
+                IORING_OP_READ,
+                IORING_OP_CLOSE
+            });
+        }
+
+
+        io_uring_sqe& Ring::prepare(std::uint64_t user_data) {
+            const unsigned index = this->_tail++ & *this->_sq_mask;
+            ++this->_unsubmitted;
+
+            io_uring_sqe& sqe = this->_sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.user_data = user_data;
+            this->_sq_array[index] = index;
+
+            return sqe;
+        }
+
+
+        bool Ring::submit(unsigned wait_for) {
+            // The kernel must see the requests before it sees the new tail.
+            __atomic_store_n(this->_sq_tail, this->_tail, __ATOMIC_RELEASE);
+
+            while (true) {
+                const long submitted = ::syscall(
+                    __NR_io_uring_enter,
+                    this->_fd,
+                    this->_unsubmitted,
+                    wait_for,
+                    wait_for ? IORING_ENTER_GETEVENTS : 0,
+                    nullptr,
+                    0
+                );
+                if (submitted >= 0) {
+                    this->_unsubmitted -= submitted;
+                    if (!this->_unsubmitted) {
+                        return true;
+                    }
+                } else if (errno != EINTR) {
+                    return false;
+                }
+            }
+        }
+
+
+        bool Ring::complete(io_uring_cqe& cqe) {
+            const unsigned head = *this->_cq_head;
+            if (head == __atomic_load_n(this->_cq_tail, __ATOMIC_ACQUIRE)) {
+                return false;
+            }
+
+            cqe = this->_cqes[head & *this->_cq_mask];
+            __atomic_store_n(this->_cq_head, head + 1, __ATOMIC_RELEASE);
+
+            return true;
+        }
+
+
+        // A file being loaded through the ring.
+        struct Slot {
+            std::size_t index = 0;
+            int fd = -1;
+            int error = 0;
+            struct stat info;
+            std::shared_ptr<Buffer> buffer;
+            std::size_t filled = 0;
+        };
+
+
+        class RingLoader {
+        private:
+            const std::vector<std::string>& _filenames;
+            const LoadCallback& _callback;
+            Ring _ring;
+            std::vector<Slot> _slots;
+            std::vector<std::size_t> _free;
+            unsigned _in_flight;
+
+            void _queue(
+                std::size_t slot, Operation operation, const io_uring_sqe& sqe
+            );
+            void _start(std::size_t slot, std::size_t index);
+            void _opened(std::size_t slot);
+            void _read(std::size_t slot);
+            void _finish(std::size_t slot);
+
+        public:
+            RingLoader(
+                const std::vector<std::string>& filenames,
+                const LoadCallback& callback
+            );
+
+            // Loads every file and returns true, or returns false right away
+            // when io_uring cannot be used.
+            bool run();
+        };
+
+
+        RingLoader::RingLoader(
+            const std::vector<std::string>& filenames,
+            const LoadCallback& callback
+        )
+            : _filenames(filenames),
+              _callback(callback),
+              _ring(RING_ENTRIES),
+              _slots(FILES_IN_FLIGHT),
+              _in_flight(0) {
+            for (std::size_t slot = FILES_IN_FLIGHT; slot-- > 0; ) {
+                this->_free.push_back(slot);
+            }
+        }
+
+
+        bool RingLoader::run() {
+            if (!this->_ring.ready()) {
+                return false;
+            }
+
+            std::size_t next = 0;
+            while (true) {
+                // Every completion makes room for the one request that its
+                // handler may queue, so only starting files can fill the ring.
+                while (
+                    next < this->_filenames.size()
+                    && !this->_free.empty()
+                    && this->_in_flight < RING_ENTRIES
+                ) {
+                    const std::size_t slot = this->_free.back();
+                    this->_free.pop_back();
+                    this->_start(slot, next++);
+                }
+
+                if (!this->_in_flight) {
+                    return true;
+                }
+
+                // A ring that stops working halfway has left the files in
+                // flight in an unknown state; their callbacks are lost.
+                if (!this->_ring.submit(1)) {
+                    throw std::system_error(
+                        errno, std::generic_category(), "io_uring_enter"
+                    );
+                }
+
+                io_uring_cqe cqe;
+                while (this->_ring.complete(cqe)) {
+                    --this->_in_flight;
+
+                    const std::size_t slot = cqe.user_data >> 2;
+                    Slot& file = this->_slots[slot];
+                    switch (cqe.user_data & 3) {
+                    case OPEN:
+                        if (cqe.res < 0) {
+                            file.error = -cqe.res;
+                        } else {
+                            file.fd = cqe.res;
+                        }
+                        this->_opened(slot);
+                        break;
+                    case READ:
+                        if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                            this->_read(slot);
+                        } else if (cqe.res < 0) {
+                            file.error = -cqe.res;
+                            this->_finish(slot);
+                        } else if (cqe.res == 0) {
+                            // Truncated since fstat().
+                            file.buffer->resize(file.filled);
+                            this->_finish(slot);
+                        } else {
+                            file.filled += cqe.res;
+                            if (file.filled < file.buffer->size()) {
+                                this->_read(slot);
+                            } else {
+                                this->_finish(slot);
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+
+        void RingLoader::_queue(
+            std::size_t slot, Operation operation, const io_uring_sqe& sqe
+        ) {
+            io_uring_sqe& queued = this->_ring.prepare(slot << 2 | operation);
+            const std::uint64_t user_data = queued.user_data;
+            queued = sqe;
+            queued.user_data = user_data;
+            ++this->_in_flight;
+        }
+
+
+        void RingLoader::_start(std::size_t slot, std::size_t index) {
+            Slot& file = this->_slots[slot];
+            file = Slot();
+            file.index = index;
+
+            io_uring_sqe open;
+            std::memset(&open, 0, sizeof(open));
+            open.opcode = IORING_OP_OPENAT;
+            open.fd = AT_FDCWD;
+            open.addr = reinterpret_cast<std::uintptr_t>(
+                this->_filenames[index].c_str()
+            );
+            open.open_flags = O_RDONLY | O_CLOEXEC;
+            this->_queue(slot, OPEN, open);
+        }
+
+
+        void RingLoader::_opened(std::size_t slot) {
+            Slot& file = this->_slots[slot];
+
+            // The open has brought the inode in, so fstat() does not block,
+            // and it costs less than a statx request handed to a kernel
+            // worker thread.
+            if (!file.error) {
+                if (::fstat(file.fd, &file.info) == -1) {
+                    file.error = errno;
+                } else if (!S_ISREG(file.info.st_mode)) {
+                    file.error = EINVAL;
+                }
+            }
+            if (file.error) {
+                this->_finish(slot);
+
+                return;
+            }
+
+            file.buffer = Buffer::allocate(
+                file.info.st_size, file.info.st_size
+            );
+            if (file.buffer->size()) {
+                this->_read(slot);
+            } else {
+                this->_finish(slot);
+            }
+        }
+
+
+        void RingLoader::_read(std::size_t slot) {
+            Slot& file = this->_slots[slot];
+
+            io_uring_sqe read;
+            std::memset(&read, 0, sizeof(read));
+            read.opcode = IORING_OP_READ;
+            read.fd = file.fd;
+            read.addr = reinterpret_cast<std::uintptr_t>(
+                file.buffer->data() + file.filled
+            );
+            read.len = std::min(file.buffer->size() - file.filled, MAX_READ);
+            read.off = file.filled;
+            this->_queue(slot, READ, read);
+        }
+
+
+        void RingLoader::_finish(std::size_t slot) {
+            Slot& file = this->_slots[slot];
+
+            // Nobody waits for the close; its completion is only counted.
+            if (file.fd != -1) {
+                io_uring_sqe close;
+                std::memset(&close, 0, sizeof(close));
+                close.opcode = IORING_OP_CLOSE;
+                close.fd = file.fd;
+                this->_queue(slot, CLOSE, close);
+            }
+
+            Txt txt;
+            if (!file.error) {
+                txt = Txt::adopt(
+                    this->_filenames[file.index],
+                    std::move(file.buffer),
+                    file.info.st_dev,
+                    file.info.st_ino,
+                    std::int64_t(file.info.st_mtim.tv_sec) * 1000000000
+                        + file.info.st_mtim.tv_nsec
+                );
+            }
+            file.buffer.reset();
+
+            this->_free.push_back(slot);
+            this->_callback(
+                file.index,
+                std::move(txt),
+                std::error_code(file.error, std::generic_category())
+            );
+        }
+
+
+        int read_file(const std::string& filename, Txt& txt) {
+            const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) {
+                return errno;
+            }
+
+            struct stat info;
+            const int error = ::fstat(fd, &info) == -1
+                ? errno
+                : S_ISREG(info.st_mode) ? 0 : EINVAL;
+            if (error) {
+                ::close(fd);
+
+                return error;
+            }
+
+            std::shared_ptr<Buffer> buffer = Buffer::allocate(
+                info.st_size, info.st_size
+            );
+            std::size_t filled = 0;
+            while (filled < buffer->size()) {
+                const ssize_t n = ::pread(
+                    fd, buffer->data() + filled, buffer->size() - filled, filled
+                );
+                if (n > 0) {
+                    filled += n;
+                } else if (n == 0) {
+                    buffer->resize(filled);
+                } else if (errno != EINTR) {
+                    const int error = errno;
+                    ::close(fd);
+
+                    return error;
+                }
+            }
+            ::close(fd);
+
+            txt = Txt::adopt(
+                filename,
+                std::move(buffer),
+                info.st_dev,
+                info.st_ino,
+                std::int64_t(info.st_mtim.tv_sec) * 1000000000
+                    + info.st_mtim.tv_nsec
+            );
+
+            return 0;
+        }
+
+
+        void load_with_pool(
+            const std::vector<std::string>& filenames,
+            const LoadCallback& callback
+        ) {
+            ThreadPool pool;
+            std::mutex m;
+
+            for (std::size_t i = 0; i < filenames.size(); ++i) {
+                pool.submit([&filenames, &callback, &m, i]() {
+                    Txt txt;
+                    const int error = read_file(filenames[i], txt);
+
+                    std::lock_guard lock(m);
+                    callback(
+                        i,
+                        std::move(txt),
+                        std::error_code(error, std::generic_category())
+                    );
+                });
+            }
+
+            pool.wait();
+        }
+    }
+
+
+    void load_files(
+        const std::vector<std::string>& filenames, const LoadCallback& callback
+    ) {
+        if (filenames.empty()) {
+            return;
+        }
+
+        RingLoader loader(filenames, callback);
+        if (!loader.run()) {
+            load_with_pool(filenames, callback);
+        }
+    }
+
+
+    std::vector<std::future<Txt>> load_files(
+        const std::vector<std::string>& filenames
+    ) {
+        auto promises = std::make_shared<std::vector<std::promise<Txt>>>(
+            filenames.size()
+        );
+
+        std::vector<std::future<Txt>> futures;
+        for (auto& promise: *promises) {
+            futures.push_back(promise.get_future());
+        }
+
+        // The loading thread owns the promises and a copy of the names, so
+        // it may outlive both the caller and the futures.
+        std::thread([promises, filenames]() {
+            std::vector<bool> kept(filenames.size());
+            try {
+                load_files(
+                    filenames,
+                    [&](std::size_t i, Txt txt, std::error_code error) {
+                        kept[i] = true;
+                        if (error) {
+                            (*promises)[i].set_exception(
+                                std::make_exception_ptr(
+                                    std::system_error(error, filenames[i])
+                                )
+                            );
+                        } else {
+                            (*promises)[i].set_value(std::move(txt));
+                        }
+                    }
+                );
+            } catch (...) {
+                for (std::size_t i = 0; i < filenames.size(); ++i) {
+                    if (!kept[i]) {
+                        (*promises)[i].set_exception(std::current_exception());
+                    }
+                }
+            }
+        }).detach();
+
+        return futures;
+    }
+}
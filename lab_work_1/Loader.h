@@ -0,0 +1,37 @@
+#ifndef LOADER_H_INCLUDED
+#define LOADER_H_INCLUDED
+
+#include <functional>
+#include <future>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "Txt.h"
+
+
+namespace l1 {
+    // Called once per file with its position in the list, the loaded Txt
+    // and what went wrong, if anything (then the Txt is empty). Calls come
+    // in completion order and never overlap.
+    using LoadCallback = std::function<
+        void(std::size_t index, Txt txt, std::error_code error)
+    >;
+
+    // Loads many files into Txt objects at once. The opens and reads of up
+    // to 32 files are kept queued in an io_uring and submitted together, and
+    // the lines of a file are counted as soon as its last read completes,
+    // while the others are still being read. Where io_uring is not
+    // available, a thread pool loads the files with pread() instead.
+    void load_files(
+        const std::vector<std::string>& filenames, const LoadCallback& callback
+    );
+
+    // The same, in the background: the futures are ready as the files are
+    // loaded, and hold a std::system_error for the ones that failed.
+    std::vector<std::future<Txt>> load_files(
+        const std::vector<std::string>& filenames
+    );
+}
+
+#endif // LOADER_H_INCLUDED
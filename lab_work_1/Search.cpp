@@ -0,0 +1,445 @@
+#include "Search.h"
+#include "Count.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define L1_X86 1
+#endif
+
+
+namespace l1 {
+    namespace {
+        const std::size_t MIN_BYTES_PER_THREAD = std::size_t(8) << 20;
+
+        // Longer patterns make the first/last char filter let through too
+        // many candidates on repetitive text, so Two-Way takes over.
+        const std::size_t MAX_FILTERED_PATTERN = 32;
+
+        // A kernel reports every match that starts in [begin, limit); the
+        // bytes up to limit + pattern.size() - 1 are readable.
+        using Kernel = void (*)(
+            const char*,
+            std::size_t,
+            std::size_t,
+            std::string_view,
+            std::vector<std::size_t>&
+        );
+
+
+        // Whether a candidate whose first and last chars already match is a
+        // match: only the chars in between are left to compare.
+        bool matches_inside(const char* candidate, std::string_view pattern) {
+            return pattern.size() <= 2 || std::memcmp(
+                candidate + 1, pattern.data() + 1, pattern.size() - 2
+            ) == 0;
+        }
+
+
+        void filter_scalar(
+            const char* data,
+            std::size_t begin,
+            std::size_t limit,
+            std::string_view pattern,
+            std::vector<std::size_t>& offsets
+        ) {
+            const char first = pattern.front();
+            const char last = pattern.back();
+            const std::size_t to_last = pattern.size() - 1;
+
+            for (std::size_t i = begin; i < limit; ++i) {
+                if (
+                    data[i] == first
+                    && data[i + to_last] == last
+                    && matches_inside(data + i, pattern)
+                ) {
+                    offsets.push_back(i);
+                }
+            }
+        }
+
+
+#ifdef L1_X86
+        // The vector kernels compare a block of candidate starts with the
+        // first char and the block 'pattern.size() - 1' further on with the
+        // last one; only starts where both agree are checked in full.
+        __attribute__((target("sse2")))
+        void filter_sse2(
+            const char* data,
+            std::size_t begin,
+            std::size_t limit,
+            std::string_view pattern,
+            std::vector<std::size_t>& offsets
+        ) {
+            const __m128i first = _mm_set1_epi8(pattern.front());
+            const __m128i last = _mm_set1_epi8(pattern.back());
+            const std::size_t to_last = pattern.size() - 1;
+            std::size_t i = begin;
+
+            for (; limit - i >= 16; i += 16) {
+                const __m128i heads = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(data + i)
+                );
+                const __m128i tails = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(data + i + to_last)
+                );
+                unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(heads, first), _mm_cmpeq_epi8(tails, last)
+                ));
+                while (mask) {
+                    const std::size_t at = i + __builtin_ctz(mask);
+                    if (matches_inside(data + at, pattern)) {
+                        offsets.push_back(at);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+
+            filter_scalar(data, i, limit, pattern, offsets);
+        }
+
+
+        __attribute__((target("avx2")))
+        void filter_avx2(
+            const char* data,
+            std::size_t begin,
+            std::size_t limit,
+            std::string_view pattern,
+            std::vector<std::size_t>& offsets
+        ) {
+            const __m256i first = _mm256_set1_epi8(pattern.front());
+            const __m256i last = _mm256_set1_epi8(pattern.back());
+            const std::size_t to_last = pattern.size() - 1;
+            std::size_t i = begin;
+
+            for (; limit - i >= 32; i += 32) {
+                const __m256i heads = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(data + i)
+                );
+                const __m256i tails = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(data + i + to_last)
+                );
+                unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(heads, first),
+                    _mm256_cmpeq_epi8(tails, last)
+                ));
+                while (mask) {
+                    const std::size_t at = i + __builtin_ctz(mask);
+                    if (matches_inside(data + at, pattern)) {
+                        offsets.push_back(at);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+
+            filter_scalar(data, i, limit, pattern, offsets);
+        }
+
+
+        __attribute__((target("avx512f,avx512bw")))
+        void filter_avx512(
+            const char* data,
+            std::size_t begin,
+            std::size_t limit,
+            std::string_view pattern,
+            std::vector<std::size_t>& offsets
+        ) {
+            const __m512i first = _mm512_set1_epi8(pattern.front());
+            const __m512i last = _mm512_set1_epi8(pattern.back());
+            const std::size_t to_last = pattern.size() - 1;
+            std::size_t i = begin;
+
+            for (; limit - i >= 64; i += 64) {
+                std::uint64_t mask = _mm512_cmpeq_epi8_mask(
+                    _mm512_loadu_si512(data + i), first
+                ) & _mm512_cmpeq_epi8_mask(
+                    _mm512_loadu_si512(data + i + to_last), last
+                );
+                while (mask) {
+                    const std::size_t at = i + __builtin_ctzll(mask);
+                    if (matches_inside(data + at, pattern)) {
+                        offsets.push_back(at);
+                    }
+                    mask &= mask - 1;
+                }
+            }
+
+            filter_scalar(data, i, limit, pattern, offsets);
+        }
+#endif
+
+
+        Kernel select_filter() {
+#ifdef L1_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512bw")) {
+                return filter_avx512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return filter_avx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return filter_sse2;
+            }
+#endif
+            return filter_scalar;
+        }
+
+
+        // Crochemore-Perrin critical factorization: the split of the pattern
+        // into a left and a right part, at the later start of the maximal
+        // suffixes for the two opposite orders of the alphabet. Returns where
+        // the right part starts and stores the period of that suffix.
+        std::size_t critical_factorization(
+            const unsigned char* pattern, std::size_t m, std::size_t& period
+        ) {
+            std::size_t suffixes[2];
+            std::size_t periods[2];
+
+            for (int reversed = 0; reversed < 2; ++reversed) {
+                // The suffix starts at 'suffix + 1'; SIZE_MAX wraps to 0.
+                std::size_t suffix = SIZE_MAX;
+                std::size_t j = 0;
+                std::size_t k = 1;
+                std::size_t p = 1;
+
+                while (j + k < m) {
+                    const unsigned char a = pattern[j + k];
+                    const unsigned char b = pattern[suffix + k];
+                    if (reversed ? b < a : a < b) {
+                        j += k;
+                        k = 1;
+                        p = j - suffix;
+                    } else if (a == b) {
+                        if (k != p) {
+                            ++k;
+                        } else {
+                            j += p;
+                            k = 1;
+                        }
+                    } else {
+                        suffix = j++;
+                        k = p = 1;
+                    }
+                }
+
+                suffixes[reversed] = suffix + 1;
+                periods[reversed] = p;
+            }
+
+            const int larger = suffixes[1] > suffixes[0];
+            period = periods[larger];
+
+            return suffixes[larger];
+        }
+
+
+        // Two-Way: the right part of the pattern is compared left to right,
+        // then the left part right to left, so no char of the text is looked
+        // at more than twice whatever the pattern. Before that, the text char
+        // under the last one of the pattern gives a Horspool skip, which is
+        // what makes non-matching text fast.
+        void two_way(
+            const char* data,
+            std::size_t begin,
+            std::size_t limit,
+            std::string_view pattern,
+            std::vector<std::size_t>& offsets
+        ) {
+            const unsigned char* x =
+                reinterpret_cast<const unsigned char*>(pattern.data());
+            const unsigned char* text =
+                reinterpret_cast<const unsigned char*>(data);
+            const std::size_t m = pattern.size();
+
+            std::size_t skips[256];
+            std::fill(std::begin(skips), std::end(skips), m);
+            for (std::size_t i = 0; i < m; ++i) {
+                skips[x[i]] = m - i - 1;
+            }
+
+            std::size_t period;
+            const std::size_t split = critical_factorization(x, m, period);
+
+            if (std::memcmp(x, x + period, split) == 0) {
+                // The pattern is periodic: after a match or a mismatch in the
+                // left part it moves by a whole period, and the overlap with
+                // its previous position, 'memory' chars, is known to match.
+                std::size_t memory = 0;
+                for (std::size_t j = begin; j < limit; ) {
+                    std::size_t skip = skips[text[j + m - 1]];
+                    if (skip) {
+                        if (memory && skip < period) {
+                            skip = m - period;
+                        }
+                        j += skip;
+                        memory = 0;
+                        continue;
+                    }
+
+                    std::size_t i = std::max(split, memory);
+                    while (i < m - 1 && x[i] == text[j + i]) {
+                        ++i;
+                    }
+                    if (i < m - 1) {
+                        j += i - split + 1;
+                        memory = 0;
+                        continue;
+                    }
+
+                    i = split;
+                    while (i > memory && x[i - 1] == text[j + i - 1]) {
+                        --i;
+                    }
+                    if (i <= memory) {
+                        offsets.push_back(j);
+                    }
+                    j += period;
+                    memory = m - period;
+                }
+            } else {
+                // Otherwise two matches are always further apart than the
+                // longer part, so moving past it after the left part is done
+                // misses nothing.
+                const std::size_t shift = std::max(split, m - split) + 1;
+                for (std::size_t j = begin; j < limit; ) {
+                    const std::size_t skip = skips[text[j + m - 1]];
+                    if (skip) {
+                        j += skip;
+                        continue;
+                    }
+
+                    std::size_t i = split;
+                    while (i < m - 1 && x[i] == text[j + i]) {
+                        ++i;
+                    }
+                    if (i < m - 1) {
+                        j += i - split + 1;
+                        continue;
+                    }
+
+                    i = split;
+                    while (i > 0 && x[i - 1] == text[j + i - 1]) {
+                        --i;
+                    }
+                    if (i == 0) {
+                        offsets.push_back(j);
+                    }
+                    j += shift;
+                }
+            }
+        }
+
+
+        // Searches the starts in [begin, end) and numbers the lines relative
+        // to 'begin'. The count of the newlines between the last match and
+        // 'end' is left in 'newlines', so the ranges can be chained.
+        std::vector<Match> search_range(
+            Kernel kernel,
+            const char* data,
+            std::size_t begin,
+            std::size_t end,
+            std::size_t limit,
+            std::string_view pattern,
+            const LineIndex* index,
+            std::size_t& newlines
+        ) {
+            std::vector<std::size_t> offsets;
+            if (begin < std::min(end, limit)) {
+                kernel(data, begin, std::min(end, limit), pattern, offsets);
+            }
+
+            std::vector<Match> matches;
+            matches.reserve(offsets.size());
+            std::size_t counted = begin;
+            std::size_t line = 0;
+            for (std::size_t offset: offsets) {
+                if (index) {
+                    line = index->line_of(offset);
+                } else {
+                    line += count_newlines(data + counted, offset - counted);
+                    counted = offset;
+                }
+                matches.push_back({offset, line});
+            }
+
+            newlines = index ? 0 : line + count_newlines(
+                data + counted, end - counted
+            );
+
+            return matches;
+        }
+    }
+
+
+    std::vector<Match> find_all(
+        const char* data,
+        std::size_t length,
+        std::string_view pattern,
+        const LineIndex* index
+    ) {
+        static const Kernel filter = select_filter();
+
+        if (pattern.empty() || pattern.size() > length) {
+            return {};
+        }
+
+        const Kernel kernel = pattern.size() <= MAX_FILTERED_PATTERN
+            ? filter
+            : two_way;
+        const std::size_t limit = length - pattern.size() + 1;
+
+        const std::size_t threads = std::min<std::size_t>(
+            std::max(std::thread::hardware_concurrency(), 1u),
+            length / MIN_BYTES_PER_THREAD
+        );
+        const std::size_t ranges = std::max<std::size_t>(threads, 1);
+
+        // A range owns the matches that start in it; the last one may end
+        // up to 'pattern.size() - 1' chars into the next range.
+        std::vector<std::vector<Match>> found(ranges);
+        std::vector<std::size_t> newlines(ranges);
+        std::vector<std::thread> workers;
+        const auto search = [&, data, length](std::size_t r) {
+            found[r] = search_range(
+                kernel,
+                data,
+                length / ranges * r,
+                r + 1 == ranges ? length : length / ranges * (r + 1),
+                limit,
+                pattern,
+                index,
+                newlines[r]
+            );
+        };
+        for (std::size_t r = 0; r + 1 < ranges; ++r) {
+            workers.emplace_back(search, r);
+        }
+        search(ranges - 1);
+        for (auto& worker: workers) {
+            worker.join();
+        }
+
+        std::size_t total = 0;
+        for (const auto& matches: found) {
+            total += matches.size();
+        }
+
+        std::vector<Match> result;
+        result.reserve(total);
+        std::size_t line_base = 0;
+        for (std::size_t r = 0; r < ranges; ++r) {
+            for (Match match: found[r]) {
+                match.line += line_base;
+                result.push_back(match);
+            }
+            line_base += newlines[r];
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef SEARCH_H_INCLUDED
+#define SEARCH_H_INCLUDED
+
+#include <string_view>
+#include <vector>
+
+#include "LineIndex.h"
+
+
+namespace l1 {
+    // Where a pattern occurs: the offset of its first char, and the number
+    // of '\n' chars before it, i.e. the line it starts on, counted from 0.
+    struct Match {
+        std::size_t offset;
+        std::size_t line;
+    };
+
+    // Every occurrence of 'pattern' in [data, data + length), overlapping
+    // ones included, in order. Patterns of up to 32 chars are found with a
+    // vectorized filter on their first and last char; longer ones with the
+    // Two-Way algorithm, which stays linear however repetitive they are.
+    // Large buffers are searched on several cores. Line numbers come from
+    // 'index' when one is given, and from counting newlines otherwise.
+    std::vector<Match> find_all(
+        const char* data,
+        std::size_t length,
+        std::string_view pattern,
+        const LineIndex* index = nullptr
+    );
+}
+
+#endif // SEARCH_H_INCLUDED
@@ -0,0 +1,324 @@
+#include "Stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define L1_X86 1
+#endif
+
+
+namespace l1 {
+    namespace {
+        const std::size_t MIN_BYTES_PER_THREAD = std::size_t(8) << 20;
+
+        // What is carried from one byte to the next while scanning.
+        struct Scan {
+            std::size_t lines = 0;
+            std::size_t words = 0;
+            std::size_t chars = 0;
+            std::uint64_t after_space = 1;
+            bool valid = true;
+
+            // UTF-8 validation: how many continuation bytes are still due,
+            // and the range the next one must fall in (narrower than
+            // 80..BF right after E0, ED, F0 and F4).
+            unsigned due = 0;
+            unsigned char low = 0x80;
+            unsigned char high = 0xBF;
+        };
+
+        using Kernel = void (*)(const char*, std::size_t, Scan&);
+
+
+        bool is_space(unsigned char c) {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
+
+
+        void validate(unsigned char c, Scan& scan) {
+            if (scan.due) {
+                if (c < scan.low || c > scan.high) {
+                    scan.valid = false;
+                }
+                --scan.due;
+                scan.low = 0x80;
+                scan.high = 0xBF;
+            } else if (c < 0x80) {
+            } else if (c < 0xC2) {
+                // A stray continuation byte, or an overlong C0/C1 lead.
+                scan.valid = false;
+            } else if (c < 0xE0) {
+                scan.due = 1;
+            } else if (c < 0xF0) {
+                scan.due = 2;
+                scan.low = c == 0xE0 ? 0xA0 : 0x80;
+                scan.high = c == 0xED ? 0x9F : 0xBF;
+            } else if (c < 0xF5) {
+                scan.due = 3;
+                scan.low = c == 0xF0 ? 0x90 : 0x80;
+                scan.high = c == 0xF4 ? 0x8F : 0xBF;
+            } else {
+                scan.valid = false;
+            }
+        }
+
+
+        void scan_scalar(const char* data, std::size_t length, Scan& scan) {
+            for (std::size_t i = 0; i < length; ++i) {
+                const unsigned char c = data[i];
+                const bool space = is_space(c);
+
+                scan.lines += c == '\n';
+                scan.chars += (c & 0xC0) != 0x80;
+                scan.words += !space && scan.after_space;
+                scan.after_space = space;
+                if (scan.valid) {
+                    validate(c, scan);
+                }
+            }
+        }
+
+
+        // Folds the masks of one 64-byte block into the scan. Bit i of each
+        // mask describes byte i of the block. Only blocks with non-ASCII
+        // bytes, or with a sequence still open, need byte-wise validation.
+        inline __attribute__((always_inline))
+        void accumulate(
+            const char* block,
+            std::uint64_t newlines,
+            std::uint64_t spaces,
+            std::uint64_t continuations,
+            std::uint64_t non_ascii,
+            Scan& scan
+        ) {
+            scan.lines += __builtin_popcountll(newlines);
+            scan.chars += 64 - __builtin_popcountll(continuations);
+            scan.words += __builtin_popcountll(
+                ~spaces & ((spaces << 1) | scan.after_space)
+            );
+            scan.after_space = spaces >> 63;
+
+            if (scan.valid && (non_ascii || scan.due)) {
+                for (std::size_t i = 0; i < 64 && scan.valid; ++i) {
+                    validate(block[i], scan);
+                }
+            }
+        }
+
+
+#ifdef L1_X86
+        __attribute__((target("sse2")))
+        void scan_sse2(const char* data, std::size_t length, Scan& scan) {
+            const __m128i newline = _mm_set1_epi8('\n');
+            const __m128i blank = _mm_set1_epi8(' ');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i four = _mm_set1_epi8(4);
+            const __m128i lowest_lead = _mm_set1_epi8(-64);
+            std::size_t i = 0;
+
+            for (; length - i >= 64; i += 64) {
+                std::uint64_t masks[4] = {0, 0, 0, 0};
+                for (int part = 0; part < 4; ++part) {
+                    const __m128i chunk = _mm_loadu_si128(
+                        reinterpret_cast<const __m128i*>(data + i + 16 * part)
+                    );
+                    // \t..\r are the bytes that land in 0..4 once 9 is
+                    // subtracted, which min() tests without signed trouble.
+                    const __m128i shifted = _mm_sub_epi8(chunk, tab);
+                    const __m128i space = _mm_or_si128(
+                        _mm_cmpeq_epi8(chunk, blank),
+                        _mm_cmpeq_epi8(_mm_min_epu8(shifted, four), shifted)
+                    );
+                    const int shift = 16 * part;
+                    masks[0] |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(chunk, newline)
+                    ))) << shift;
+                    masks[1] |= std::uint64_t(std::uint16_t(
+                        _mm_movemask_epi8(space)
+                    )) << shift;
+                    masks[2] |= std::uint64_t(std::uint16_t(_mm_movemask_epi8(
+                        _mm_cmplt_epi8(chunk, lowest_lead)
+                    ))) << shift;
+                    masks[3] |= std::uint64_t(std::uint16_t(
+                        _mm_movemask_epi8(chunk)
+                    )) << shift;
+                }
+                accumulate(
+                    data + i, masks[0], masks[1], masks[2], masks[3], scan
+                );
+            }
+
+            scan_scalar(data + i, length - i, scan);
+        }
+
+
+        __attribute__((target("avx2")))
+        void scan_avx2(const char* data, std::size_t length, Scan& scan) {
+            const __m256i newline = _mm256_set1_epi8('\n');
+            const __m256i blank = _mm256_set1_epi8(' ');
+            const __m256i tab = _mm256_set1_epi8('\t');
+            const __m256i four = _mm256_set1_epi8(4);
+            const __m256i lowest_lead = _mm256_set1_epi8(-64);
+            std::size_t i = 0;
+
+            for (; length - i >= 64; i += 64) {
+                std::uint64_t masks[4] = {0, 0, 0, 0};
+                for (int part = 0; part < 2; ++part) {
+                    const __m256i chunk = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(data + i + 32 * part)
+                    );
+                    const __m256i shifted = _mm256_sub_epi8(chunk, tab);
+                    const __m256i space = _mm256_or_si256(
+                        _mm256_cmpeq_epi8(chunk, blank),
+                        _mm256_cmpeq_epi8(
+                            _mm256_min_epu8(shifted, four), shifted
+                        )
+                    );
+                    const int shift = 32 * part;
+                    masks[0] |= std::uint64_t(std::uint32_t(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline))
+                    )) << shift;
+                    masks[1] |= std::uint64_t(std::uint32_t(
+                        _mm256_movemask_epi8(space)
+                    )) << shift;
+                    masks[2] |= std::uint64_t(std::uint32_t(
+                        _mm256_movemask_epi8(
+                            _mm256_cmpgt_epi8(lowest_lead, chunk)
+                        )
+                    )) << shift;
+                    masks[3] |= std::uint64_t(std::uint32_t(
+                        _mm256_movemask_epi8(chunk)
+                    )) << shift;
+                }
+                accumulate(
+                    data + i, masks[0], masks[1], masks[2], masks[3], scan
+                );
+            }
+
+            scan_scalar(data + i, length - i, scan);
+        }
+
+
+        __attribute__((target("avx512f,avx512bw")))
+        void scan_avx512(const char* data, std::size_t length, Scan& scan) {
+            const __m512i newline = _mm512_set1_epi8('\n');
+            const __m512i blank = _mm512_set1_epi8(' ');
+            const __m512i tab = _mm512_set1_epi8('\t');
+            const __m512i four = _mm512_set1_epi8(4);
+            const __m512i lowest_lead = _mm512_set1_epi8(-64);
+            const __m512i zero = _mm512_setzero_si512();
+            std::size_t i = 0;
+
+            for (; length - i >= 64; i += 64) {
+                const __m512i chunk = _mm512_loadu_si512(data + i);
+                const __m512i shifted = _mm512_sub_epi8(chunk, tab);
+                accumulate(
+                    data + i,
+                    _mm512_cmpeq_epi8_mask(chunk, newline),
+                    _mm512_cmpeq_epi8_mask(chunk, blank)
+                        | _mm512_cmple_epu8_mask(shifted, four),
+                    _mm512_cmplt_epi8_mask(chunk, lowest_lead),
+                    _mm512_cmplt_epi8_mask(chunk, zero),
+                    scan
+                );
+            }
+
+            scan_scalar(data + i, length - i, scan);
+        }
+#endif
+
+
+        Kernel select_kernel() {
+#ifdef L1_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512bw")) {
+                return scan_avx512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return scan_avx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return scan_sse2;
+            }
+#endif
+            return scan_scalar;
+        }
+
+
+        // Scans [begin, end) as a piece of the whole buffer: whether a word
+        // starts at 'begin' depends on the byte just before it.
+        Scan scan_range(
+            Kernel kernel, const char* data, std::size_t begin, std::size_t end
+        ) {
+            Scan scan;
+            scan.after_space = begin == 0
+                || is_space(static_cast<unsigned char>(data[begin - 1]));
+            kernel(data + begin, end - begin, scan);
+
+            // A sequence cut off by the end of the range is cut off in the
+            // whole buffer too, as ranges never start on a continuation byte
+            // that belongs to an earlier lead.
+            scan.valid = scan.valid && !scan.due;
+
+            return scan;
+        }
+    }
+
+
+    TextStats compute_stats(const char* data, std::size_t length) {
+        static const Kernel kernel = select_kernel();
+
+        const std::size_t threads = std::min<std::size_t>(
+            std::max(std::thread::hardware_concurrency(), 1u),
+            length / MIN_BYTES_PER_THREAD
+        );
+
+        // Boundaries move forward past continuation bytes (at most three
+        // of them in valid UTF-8) so each range starts on a whole code
+        // point.
+        std::vector<std::size_t> bounds(1, 0);
+        for (std::size_t t = 1; t < threads; ++t) {
+            std::size_t bound = std::max(length / threads * t, bounds.back());
+            for (
+                int step = 0;
+                step < 3 && bound < length
+                    && (static_cast<unsigned char>(data[bound]) & 0xC0) == 0x80;
+                ++step
+            ) {
+                ++bound;
+            }
+            bounds.push_back(bound);
+        }
+        bounds.push_back(length);
+
+        const std::size_t ranges = bounds.size() - 1;
+        std::vector<Scan> scans(ranges);
+        std::vector<std::thread> workers;
+        for (std::size_t r = 0; r + 1 < ranges; ++r) {
+            workers.emplace_back([&scans, &bounds, data, r]() {
+                scans[r] = scan_range(kernel, data, bounds[r], bounds[r + 1]);
+            });
+        }
+        scans[ranges - 1] = scan_range(
+            kernel, data, bounds[ranges - 1], bounds[ranges]
+        );
+        for (auto& worker: workers) {
+            worker.join();
+        }
+
+        TextStats stats;
+        stats.bytes = length;
+        for (const Scan& scan: scans) {
+            stats.lines += scan.lines;
+            stats.words += scan.words;
+            stats.chars += scan.chars;
+            stats.valid_utf8 = stats.valid_utf8 && scan.valid;
+        }
+
+        return stats;
+    }
+}
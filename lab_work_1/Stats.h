@@ -0,0 +1,28 @@
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <cstddef>
+
+
+namespace l1 {
+    // What 'wc' reports about a text, plus whether it is valid UTF-8.
+    // A word is a run of bytes other than ASCII whitespace. 'chars' counts
+    // the bytes that start a code point, which for valid UTF-8 is the number
+    // of code points.
+    struct TextStats {
+        std::size_t lines = 0;
+        std::size_t words = 0;
+        std::size_t chars = 0;
+        std::size_t bytes = 0;
+        bool valid_utf8 = true;
+    };
+
+    // Computes all of TextStats in one pass over [data, data + length).
+    // Like count_newlines(), it picks its kernel at run time and splits
+    // large buffers across cores; chunk boundaries are moved so that they
+    // never split a UTF-8 sequence, and words crossing them are counted
+    // once.
+    TextStats compute_stats(const char* data, std::size_t length);
+}
+
+#endif // STATS_H_INCLUDED
@@ -0,0 +1,129 @@
+#include "StreamTxt.h"
+#include "Count.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace l1 {
+    namespace {
+        // One half of the double buffer. The reader owns it while it is
+        // not full, the scanner owns it while it is.
+        struct Slot {
+            std::unique_ptr<char[]> data;
+            std::size_t filled = 0;
+            bool full = false;
+        };
+
+
+        std::size_t read_fully(int fd, char* buffer, std::size_t size) {
+            std::size_t filled = 0;
+
+            while (filled < size) {
+                const ssize_t n = ::read(fd, buffer + filled, size - filled);
+                if (n > 0) {
+                    filled += n;
+                } else if (n == 0 || errno != EINTR) {
+                    // End of file; a read error ends the stream the same way.
+                    break;
+                }
+            }
+
+            return filled;
+        }
+    }
+
+
+    StreamTxt::StreamTxt(const std::string& filename, std::size_t buffer_size)
+        : _number_of_lines(0),
+          _number_of_chars(0) {
+        const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd == -1) {
+            return;
+        }
+
+        if (!buffer_size) {
+            buffer_size = DEFAULT_BUFFER_SIZE;
+        }
+
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        Slot slots[2];
+        for (auto& slot: slots) {
+            slot.data.reset(new char[buffer_size]);
+        }
+        std::mutex m;
+        std::condition_variable cv;
+
+        // A short read marks the end of the file, so the reader stops after
+        // handing over the first slot that is not filled completely.
+        std::thread reader([&]() {
+            for (std::size_t i = 0; ; i ^= 1) {
+                Slot& slot = slots[i];
+                {
+                    std::unique_lock lock(m);
+                    cv.wait(lock, [&slot]() { return !slot.full; });
+                }
+
+                const std::size_t filled = read_fully(
+                    fd, slot.data.get(), buffer_size
+                );
+
+                {
+                    std::lock_guard lock(m);
+                    slot.filled = filled;
+                    slot.full = true;
+                }
+                cv.notify_all();
+
+                if (filled < buffer_size) {
+                    return;
+                }
+            }
+        });
+
+        for (std::size_t i = 0; ; i ^= 1) {
+            Slot& slot = slots[i];
+            {
+                std::unique_lock lock(m);
+                cv.wait(lock, [&slot]() { return slot.full; });
+            }
+
+            this->_number_of_lines += count_newlines(
+                slot.data.get(), slot.filled
+            );
+            this->_number_of_chars += slot.filled;
+
+            const bool last = slot.filled < buffer_size;
+            {
+                std::lock_guard lock(m);
+                slot.full = false;
+            }
+            cv.notify_all();
+
+            if (last) {
+                break;
+            }
+        }
+
+        reader.join();
+        ::close(fd);
+    }
+
+
+    std::size_t StreamTxt::size() const {
+        return this->_number_of_lines;
+    }
+
+
+    std::size_t StreamTxt::length() const {
+        return this->_number_of_chars;
+    }
+}
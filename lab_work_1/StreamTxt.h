@@ -0,0 +1,30 @@
+#ifndef STREAM_TXT_H_INCLUDED
+#define STREAM_TXT_H_INCLUDED
+
+#include <string>
+
+
+namespace l1 {
+    // Counts the lines and chars of a file without keeping it in memory.
+    // The file is read through two fixed-size buffers: while one of them
+    // is being scanned, a reader thread fills the other, so memory use
+    // does not depend on the size of the file.
+    class StreamTxt {
+    private:
+        std::size_t _number_of_lines;
+        std::size_t _number_of_chars;
+
+    public:
+        static const std::size_t DEFAULT_BUFFER_SIZE = std::size_t(1) << 20;
+
+        StreamTxt(
+            const std::string& filename = "",
+            std::size_t buffer_size = DEFAULT_BUFFER_SIZE
+        );
+
+        std::size_t size() const;
+        std::size_t length() const;
+    };
+}
+
+#endif // STREAM_TXT_H_INCLUDED
@@ -0,0 +1,149 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+
+namespace l1 {
+    namespace {
+        // Lets submit() called from inside a task push to the deque of the
+        // worker running it, where that worker will find it first.
+        thread_local const ThreadPool* current_pool = nullptr;
+        thread_local std::size_t current_worker = 0;
+    }
+
+
+    ThreadPool::ThreadPool(std::size_t threads)
+        : _next(0),
+          _queued(0),
+          _pending(0),
+          _stop(false) {
+        if (!threads) {
+            threads = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        for (std::size_t i = 0; i < threads; ++i) {
+            this->_workers.emplace_back(new Worker());
+        }
+        for (std::size_t i = 0; i < threads; ++i) {
+            this->_threads.emplace_back(&ThreadPool::_run, this, i);
+        }
+    }
+
+
+    ThreadPool::~ThreadPool() {
+        this->wait();
+
+        {
+            std::lock_guard lock(this->_m);
+            this->_stop = true;
+        }
+        this->_task_available.notify_all();
+
+        for (auto& thread: this->_threads) {
+            thread.join();
+        }
+    }
+
+
+    std::size_t ThreadPool::size() const {
+        return this->_workers.size();
+    }
+
+
+    void ThreadPool::submit(Task task) {
+        const std::size_t target = current_pool == this
+            ? current_worker
+            : this->_next++ % this->_workers.size();
+
+        // The task is pending before it becomes visible, so that wait()
+        // cannot miss it, but only queued once it is in a deque, so that
+        // _queued never exceeds the number of tasks actually in the deques.
+        {
+            std::lock_guard lock(this->_m);
+            ++this->_pending;
+        }
+        {
+            Worker& worker = *this->_workers[target];
+            std::lock_guard lock(worker.m);
+            worker.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard lock(this->_m);
+            ++this->_queued;
+        }
+        this->_task_available.notify_one();
+    }
+
+
+    void ThreadPool::wait() {
+        std::unique_lock lock(this->_m);
+        this->_all_done.wait(lock, [this]() { return this->_pending == 0; });
+    }
+
+
+    bool ThreadPool::_take(std::size_t self, Task& task) {
+        {
+            Worker& own = *this->_workers[self];
+            std::lock_guard lock(own.m);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+
+                return true;
+            }
+        }
+
+        for (std::size_t i = 1; i < this->_workers.size(); ++i) {
+            const std::size_t other = (self + i) % this->_workers.size();
+            Worker& victim = *this->_workers[other];
+            std::lock_guard lock(victim.m);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    void ThreadPool::_run(std::size_t self) {
+        current_pool = this;
+        current_worker = self;
+
+        while (true) {
+            {
+                std::unique_lock lock(this->_m);
+                this->_task_available.wait(lock, [this]() {
+                    return this->_queued > 0 || this->_stop;
+                });
+                if (this->_queued == 0) {
+                    return;
+                }
+                --this->_queued;
+            }
+
+            // The worker has claimed a task that is in some deque, so idle
+            // workers stay blocked above. A scan can still come up empty if
+            // other workers take tasks from under it while new ones land
+            // behind it; it is simply done again.
+            Task task;
+            while (!this->_take(self, task)) {
+                std::this_thread::yield();
+            }
+
+            task();
+
+            bool done;
+            {
+                std::lock_guard lock(this->_m);
+                done = --this->_pending == 0;
+            }
+            if (done) {
+                this->_all_done.notify_all();
+            }
+        }
+    }
+}
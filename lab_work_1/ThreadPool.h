@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H_INCLUDED
+#define THREAD_POOL_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace l1 {
+    // A fixed set of worker threads with a task deque each. A worker takes
+    // its newest task first and, when its own deque runs dry, steals the
+    // oldest task of another worker, so uneven batches even out on their own.
+    class ThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+    private:
+        struct Worker {
+            std::mutex m;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::vector<std::thread> _threads;
+        std::atomic<std::size_t> _next;
+
+        std::mutex _m;
+        std::condition_variable _task_available;
+        std::condition_variable _all_done;
+        std::size_t _queued;
+        std::size_t _pending;
+        bool _stop;
+
+        bool _take(std::size_t self, Task& task);
+        void _run(std::size_t self);
+
+    public:
+        // Zero threads means one per hardware thread.
+        explicit ThreadPool(std::size_t threads = 0);
+
+        ThreadPool(const ThreadPool& other) = delete;
+        ThreadPool& operator=(const ThreadPool& other) = delete;
+
+        ~ThreadPool();
+
+        std::size_t size() const;
+
+        void submit(Task task);
+
+        // Blocks until every submitted task has finished.
+        void wait();
+    };
+}
+
+#endif // THREAD_POOL_H_INCLUDED
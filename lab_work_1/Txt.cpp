@@ -1,60 +1,151 @@
 #include "Txt.h"
+#include "Count.h"
 
-#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 namespace l1 {
-    Txt::Txt(const std::string& filename) {
-        std::ifstream file(filename);
+    namespace {
+        const std::size_t HASHED_TAIL = 4096;
 
-        if (!file.is_open()) {
-            this->_content = nullptr;
-            this->_number_of_lines = 0;
-            this->_number_of_chars = 0;
 
-            return;
+        // FNV-1a of the last HASHED_TAIL bytes of data[0, length), as the
+        // sidecar hashes the ends of a file.
+        std::uint64_t tail_hash(const char* data, std::size_t length) {
+            const std::size_t hashed = std::min(length, HASHED_TAIL);
+
+            std::uint64_t h = 14695981039346656037ull;
+            for (std::size_t i = length - hashed; i < length; ++i) {
+                h ^= static_cast<unsigned char>(data[i]);
+                h *= 1099511628211ull;
+            }
+
+            return h;
         }
 
-        file.seekg(0, std::ios_base::end);
 
-        this->_number_of_chars = file.tellg();
-        this->_content = new char[this->_number_of_chars + 1];
+        std::int64_t modification_time(const struct stat& info) {
+            return std::int64_t(info.st_mtim.tv_sec) * 1000000000
+                + info.st_mtim.tv_nsec;
+        }
+    }
 
-        file.seekg(0, std::ios_base::beg);
 
-        file.read(this->_content, this->_number_of_chars);
-        this->_content[this->_number_of_chars] = '\0';
+    Txt::Txt(
+        const std::string& filename,
+        LoadMode mode,
+        Indexing indexing,
+        Sidecar sidecar,
+        std::pmr::memory_resource* resource
+    )
+        : _filename(filename),
+          _mode(mode),
+          _sidecar(sidecar),
+          _resource(resource),
+          _number_of_lines(0),
+          _number_of_chars(0) {
+        // Observing the file before loading it errs on the safe side: if it
+        // is replaced in between, the next refresh() reloads it again.
+        struct stat info;
+        const bool observed = ::stat(filename.c_str(), &info) == 0;
+        if (observed) {
+            this->_observation.device = info.st_dev;
+            this->_observation.inode = info.st_ino;
+            this->_observation.modified = modification_time(info);
+        }
 
-        this->_number_of_lines = 0;
-        for (std::size_t i = 0; i < this->_number_of_chars; ++i) {
-            if (this->_content[i] == '\n') {
-                ++this->_number_of_lines;
-            }
+        // Whatever the sidecar covers need not be read ahead of the scan.
+        LineCheckpoints checkpoints;
+        const bool checkpointed = sidecar == Sidecar::ON
+            && indexing == Indexing::LAZY;
+        if (
+            checkpointed
+            && (
+                !checkpoints.load(filename)
+                || checkpoints.inode() != this->_observation.inode
+            )
+        ) {
+            checkpoints = LineCheckpoints();
         }
 
-        file.close();
-    }
+        // A file that cannot be mapped (a pipe, a special file) is still
+        // worth reading the ordinary way. It goes straight there, since
+        // opening a FIFO once more to find out can block for good.
+        const bool regular = observed && S_ISREG(info.st_mode);
+        if (mode == LoadMode::MAP && regular) {
+            this->_buffer = Buffer::map(filename, checkpoints.length());
+        }
+        if (!this->_buffer) {
+            this->_buffer = Buffer::read(filename, resource);
+        }
 
+        if (this->_buffer) {
+            this->_number_of_chars = this->_buffer->size();
+            if (checkpointed) {
+                this->_count_lines(checkpoints);
+            } else {
+                this->_count_lines(indexing);
+            }
+            this->_observation.tail_hash = tail_hash(
+                this->_content(), this->_number_of_chars
+            );
+        }
+    }
 
-    Txt::Txt(const Txt& other)
-        : _number_of_lines(other._number_of_lines),
-          _number_of_chars(other._number_of_chars) {
-        if (!other._number_of_chars) {
-            this->_content = nullptr;
 
-            return;
+    Txt::Txt(
+        const std::string& filename,
+        std::shared_ptr<Buffer> buffer,
+        const Observation& observation
+    )
+        : _filename(filename),
+          _mode(LoadMode::READ),
+          _sidecar(Sidecar::OFF),
+          _resource(nullptr),
+          _observation(observation),
+          _buffer(std::move(buffer)),
+          _number_of_lines(0),
+          _number_of_chars(0) {
+        if (this->_buffer) {
+            this->_number_of_chars = this->_buffer->size();
+            this->_count_lines(Indexing::LAZY);
+            this->_observation.tail_hash = tail_hash(
+                this->_content(), this->_number_of_chars
+            );
         }
-
-        this->_content = new char[this->_number_of_chars + 1];
-        strcpy(this->_content, other._content);
     }
 
 
+    // Copies share the buffer and the line index, so copying costs two
+    // reference count increments however big the file is.
+    Txt::Txt(const Txt& other)
+        : _filename(other._filename),
+          _mode(other._mode),
+          _sidecar(other._sidecar),
+          _resource(other._resource),
+          _observation(other._observation),
+          _buffer(other._buffer),
+          _number_of_lines(other._number_of_lines),
+          _number_of_chars(other._number_of_chars),
+          _index(std::atomic_load(&other._index)) {}
+
+
     Txt::Txt(Txt&& other)
-        : _content(other._content),
+        : _filename(std::move(other._filename)),
+          _mode(other._mode),
+          _sidecar(other._sidecar),
+          _resource(other._resource),
+          _observation(other._observation),
+          _buffer(std::move(other._buffer)),
           _number_of_lines(other._number_of_lines),
-          _number_of_chars(other._number_of_chars) {
-        other._content = nullptr;
+          _number_of_chars(other._number_of_chars),
+          _index(std::move(other._index)) {
         other._number_of_lines = 0;
         other._number_of_chars = 0;
     }
@@ -62,15 +153,15 @@ namespace l1 {
 
     Txt& Txt::operator=(const Txt& other) {
         if (this != &other) {
-            delete[] this->_content;
+            this->_filename = other._filename;
+            this->_mode = other._mode;
+            this->_sidecar = other._sidecar;
+            this->_resource = other._resource;
+            this->_observation = other._observation;
+            this->_buffer = other._buffer;
             this->_number_of_lines = other._number_of_lines;
             this->_number_of_chars = other._number_of_chars;
-            if (other._number_of_chars) {
-                this->_content = new char[this->_number_of_chars + 1];
-                strcpy(this->_content, other._content);
-            } else {
-                this->_content = nullptr;
-            }
+            this->_index = std::atomic_load(&other._index);
         }
 
         return *this;
@@ -80,11 +171,15 @@ namespace l1 {
 
     Txt& Txt::operator=(Txt&& other) {
         if (this != &other) {
-            delete[] this->_content;
+            this->_filename = std::move(other._filename);
+            this->_mode = other._mode;
+            this->_sidecar = other._sidecar;
+            this->_resource = other._resource;
+            this->_observation = other._observation;
+            this->_buffer = std::move(other._buffer);
             this->_number_of_lines = other._number_of_lines;
             this->_number_of_chars = other._number_of_chars;
-            this->_content = other._content;
-            other._content = nullptr;
+            this->_index = std::move(other._index);
             other._number_of_lines = 0;
             other._number_of_chars = 0;
         }
@@ -93,12 +188,280 @@ namespace l1 {
     }
 
 
-    Txt::~Txt() {
-        delete[] this->_content;
+    Txt::~Txt() {}
+
+
+    Txt Txt::adopt(
+        const std::string& filename,
+        std::shared_ptr<Buffer> buffer,
+        std::uint64_t device,
+        std::uint64_t inode,
+        std::int64_t modified
+    ) {
+        Observation observation;
+        observation.device = device;
+        observation.inode = inode;
+        observation.modified = modified;
+
+        return Txt(filename, std::move(buffer), observation);
     }
 
 
     std::size_t Txt::size() const {
         return this->_number_of_lines;
     }
+
+
+    std::size_t Txt::length() const {
+        return this->_number_of_chars;
+    }
+
+
+    const std::string& Txt::filename() const {
+        return this->_filename;
+    }
+
+
+    std::string_view Txt::line(std::size_t i) const {
+        if (i >= this->_number_of_lines) {
+            throw std::out_of_range("Line number is out of range");
+        }
+
+        const std::shared_ptr<const LineIndex> index = this->_line_index();
+        const std::size_t begin = index->start(i);
+        const std::size_t end = index->start(i + 1) - 1;
+
+        return std::string_view(this->_content() + begin, end - begin);
+    }
+
+
+    void Txt::_count_lines(Indexing indexing) {
+        if (indexing == Indexing::EAGER) {
+            this->_index = std::make_shared<LineIndex>(
+                this->_content(), this->_number_of_chars
+            );
+            this->_number_of_lines = this->_index->lines();
+
+            return;
+        }
+
+        this->_number_of_lines = count_newlines(
+            this->_content(), this->_number_of_chars
+        );
+    }
+
+
+    void Txt::_count_lines(LineCheckpoints& checkpoints) {
+        const char* data = this->_content();
+
+        // Counts loaded for other content are thrown away; a file that only
+        // grew keeps them and gets its new bytes counted. A file written to
+        // since the counts were saved may have been edited in the middle,
+        // where the hashes do not look, so only the strides whose
+        // fingerprints still match are kept.
+        if (!checkpoints.is_prefix_of(data, this->_number_of_chars)) {
+            checkpoints = LineCheckpoints();
+        } else if (checkpoints.modified() != this->_observation.modified) {
+            checkpoints.verify(data);
+        }
+
+        const bool unchanged = checkpoints.length() == this->_number_of_chars
+            && checkpoints.modified() == this->_observation.modified;
+
+        checkpoints.extend(data, this->_number_of_chars);
+        this->_number_of_lines = checkpoints.lines();
+
+        if (!unchanged) {
+            checkpoints.save(
+                this->_filename,
+                data,
+                this->_observation.inode,
+                this->_observation.modified
+            );
+        }
+    }
+
+
+    std::shared_ptr<const LineIndex> Txt::_line_index() const {
+        // Concurrent first calls may both build the index; each caller keeps
+        // its own copy alive and one of the identical results is stored, so
+        // const member functions stay safe to call from several threads.
+        std::shared_ptr<LineIndex> index = std::atomic_load(&this->_index);
+
+        if (!index) {
+            index = std::make_shared<LineIndex>(
+                this->_content(), this->_number_of_chars
+            );
+            std::atomic_store(&this->_index, index);
+        }
+
+        return index;
+    }
+
+
+    const char* Txt::_content() const {
+        return this->_buffer ? this->_buffer->data() : nullptr;
+    }
+
+
+    char* Txt::_writable_content(std::size_t size) {
+        const bool writable = this->_buffer
+            && this->_buffer.use_count() == 1
+            && !this->_buffer->mapped()
+            && this->_buffer->capacity() >= size;
+
+        if (!writable) {
+            const std::size_t kept = this->_buffer
+                ? std::min(this->_buffer->size(), size)
+                : 0;
+            const std::size_t capacity = this->_buffer
+                ? std::max(size, 2 * this->_buffer->capacity())
+                : size;
+            this->_buffer = Buffer::copy(
+                this->_content(), kept, capacity, this->_resource
+            );
+        }
+        this->_buffer->resize(size);
+
+        return this->_buffer->data();
+    }
+
+
+    TextStats Txt::stats() const {
+        return compute_stats(this->_content(), this->_number_of_chars);
+    }
+
+
+    std::vector<Match> Txt::find_all(std::string_view pattern) const {
+        // Building the index only for this would cost more than the
+        // newline counting it replaces.
+        const std::shared_ptr<LineIndex> index =
+            std::atomic_load(&this->_index);
+
+        return l1::find_all(
+            this->_content(), this->_number_of_chars, pattern, index.get()
+        );
+    }
+
+
+    Refresh Txt::refresh() {
+        struct stat info;
+        const bool exists = ::stat(this->_filename.c_str(), &info) == 0;
+
+        if (!exists && !this->_buffer) {
+            return Refresh::UNCHANGED;
+        }
+
+        const std::size_t size = exists ? info.st_size : 0;
+        const bool same_file = exists
+            && this->_buffer
+            && std::uint64_t(info.st_dev) == this->_observation.device
+            && std::uint64_t(info.st_ino) == this->_observation.inode;
+        const bool same_time = exists
+            && modification_time(info) == this->_observation.modified;
+
+        if (same_file && size == this->_number_of_chars && same_time) {
+            return Refresh::UNCHANGED;
+        }
+
+        if (same_file && size > this->_number_of_chars && this->_append(size)) {
+            this->_observation.modified = modification_time(info);
+
+            return Refresh::APPENDED;
+        }
+
+        *this = Txt(
+            this->_filename,
+            this->_mode,
+            Indexing::LAZY,
+            this->_sidecar,
+            this->_resource
+        );
+
+        return Refresh::RELOADED;
+    }
+
+
+    bool Txt::_append(std::size_t size) {
+        const std::size_t old_size = this->_number_of_chars;
+
+        if (this->_buffer->mapped()) {
+            // Mapping the grown file again only sets up page tables; the
+            // old part is already in the page cache and is not rescanned.
+            std::shared_ptr<Buffer> buffer = Buffer::map(
+                this->_filename, old_size
+            );
+            if (!buffer || buffer->size() < old_size) {
+                return false;
+            }
+
+            this->_buffer = std::move(buffer);
+            size = this->_buffer->size();
+        } else {
+            const int fd = ::open(
+                this->_filename.c_str(), O_RDONLY | O_CLOEXEC
+            );
+            if (fd == -1) {
+                return false;
+            }
+
+            struct stat info;
+            if (
+                ::fstat(fd, &info) == -1
+                || std::uint64_t(info.st_ino) != this->_observation.inode
+            ) {
+                ::close(fd);
+
+                return false;
+            }
+
+            // The last bytes already loaded are read again along with the
+            // new ones, to be checked below.
+            char* data = this->_writable_content(size);
+            std::size_t filled = old_size - std::min(old_size, HASHED_TAIL);
+            while (filled < size) {
+                const ssize_t n = ::pread(
+                    fd, data + filled, size - filled, filled
+                );
+                if (n > 0) {
+                    filled += n;
+                } else if (n == 0 || errno != EINTR) {
+                    break;
+                }
+            }
+            ::close(fd);
+
+            // The file may have been truncated since stat(); keep whatever
+            // could be read and let the next refresh() sort it out.
+            this->_buffer->resize(filled);
+            size = filled;
+            if (size < old_size) {
+                return false;
+            }
+        }
+
+        // A file truncated and written again past its old size between two
+        // refreshes grows like an appended one, but not from the same bytes.
+        const char* data = this->_content();
+        if (tail_hash(data, old_size) != this->_observation.tail_hash) {
+            return false;
+        }
+
+        this->_number_of_lines += count_newlines(
+            data + old_size, size - old_size
+        );
+        this->_number_of_chars = size;
+
+        // Copies of this Txt keep the index they share; only an index of
+        // our own is extended in place.
+        if (this->_index) {
+            if (this->_index.use_count() > 1) {
+                this->_index = std::make_shared<LineIndex>(*this->_index);
+            }
+            this->_index->extend(data, old_size, size);
+        }
+        this->_observation.tail_hash = tail_hash(data, size);
+
+        return true;
+    }
 }
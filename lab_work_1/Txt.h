@@ -1,18 +1,109 @@
 #ifndef TXT_H_INCLUDED
 #define TXT_H_INCLUDED
 
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Buffer.h"
+#include "LineCheckpoints.h"
+#include "LineIndex.h"
+#include "Search.h"
+#include "Stats.h"
 
 
 namespace l1 {
+    // How the file contents get into memory: READ copies them into a heap
+    // buffer, MAP maps the file read-only and scans the mapping in place.
+    enum class LoadMode {
+        READ,
+        MAP
+    };
+
+    // When the line index behind Txt::line() is built: on the first call
+    // to line(), or right away, in the same pass that counts the lines.
+    enum class Indexing {
+        LAZY,
+        EAGER
+    };
+
+    // Whether the line count is kept in a sidecar file next to the text
+    // file (see LineCheckpoints), so that opening an unchanged file again
+    // does not scan it. An appended file has its old bytes checked against
+    // sampled fingerprints of each 1 MiB stride, which reads about 1 KiB of
+    // each, and then only the new bytes are counted.
+    // Lazy indexing only: an eager index needs the full pass anyway.
+    enum class Sidecar {
+        OFF,
+        ON
+    };
+
+    // What Txt::refresh() found: nothing new, bytes appended to the file
+    // it already had, or a truncated, replaced or vanished file.
+    enum class Refresh {
+        UNCHANGED,
+        APPENDED,
+        RELOADED
+    };
+
     class Txt {
     private:
-        std::ifstream::char_type* _content;
+        // Which file the content came from, as last observed by stat(), so
+        // that refresh() can tell an appended file from a replaced one.
+        struct Observation {
+            std::uint64_t device = 0;
+            std::uint64_t inode = 0;
+            std::int64_t modified = 0;
+            // Of the last bytes loaded, to tell bytes appended to them from
+            // a file that was truncated and written again past its old size
+            std::uint64_t tail_hash = 0;
+        };
+
+        std::string _filename;
+        LoadMode _mode;
+        Sidecar _sidecar;
+        std::pmr::memory_resource* _resource;
+        Observation _observation;
+        std::shared_ptr<Buffer> _buffer;
         std::size_t _number_of_lines;
         std::size_t _number_of_chars;
+        mutable std::shared_ptr<LineIndex> _index;
+
+        Txt(
+            const std::string& filename,
+            std::shared_ptr<Buffer> buffer,
+            const Observation& observation
+        );
+
+        void _count_lines(Indexing indexing);
+        void _count_lines(LineCheckpoints& checkpoints);
+        std::shared_ptr<const LineIndex> _line_index() const;
+        const char* _content() const;
+        bool _append(std::size_t size);
+
+        // Copy on write: gives this Txt a heap buffer of its own, 'size'
+        // bytes long, that starts with the current content. The content is
+        // copied if the buffer is shared, mapped or too small; buffers grow
+        // geometrically so that repeated appends copy each byte O(1) times.
+        // The caller is responsible for the line index.
+        char* _writable_content(std::size_t size);
 
     public:
-        Txt(const std::string& filename = "");
+        // READ content, and content that grows, lives in memory from
+        // 'resource' (see BufferPool and HugePageResource), or from the
+        // default memory resource when none is given. The resource must
+        // outlive this Txt and every copy of it.
+        Txt(
+            const std::string& filename = "",
+            LoadMode mode = LoadMode::READ,
+            Indexing indexing = Indexing::LAZY,
+            Sidecar sidecar = Sidecar::OFF,
+            std::pmr::memory_resource* resource = nullptr
+        );
         Txt(const Txt& other);
         Txt(Txt&& other);
 
@@ -21,7 +112,37 @@ namespace l1 {
 
         ~Txt();
 
+        // A Txt for content that was loaded elsewhere, e.g. by load_files(),
+        // from the file with the given identity; only its lines are counted.
+        static Txt adopt(
+            const std::string& filename,
+            std::shared_ptr<Buffer> buffer,
+            std::uint64_t device,
+            std::uint64_t inode,
+            std::int64_t modified
+        );
+
         std::size_t size() const;
+        std::size_t length() const;
+        const std::string& filename() const;
+
+        // Line 'i' without its '\n'. Only lines terminated by '\n' are
+        // counted by size(), so 'i' must be less than size().
+        std::string_view line(std::size_t i) const;
+
+        // Lines, words, UTF-8 code points and validity, in one pass.
+        TextStats stats() const;
+
+        // Every occurrence of 'pattern', with the line it starts on. Uses
+        // the line index if one has been built already.
+        std::vector<Match> find_all(std::string_view pattern) const;
+
+        // Brings the content up to date with the file. Bytes appended since
+        // the last observation are read and counted on their own; a file
+        // that shrank, changed in place, was replaced (e.g. rotated) or was
+        // truncated and written again past its old size (copytruncate) is
+        // loaded again from scratch.
+        Refresh refresh();
     };
 }
 
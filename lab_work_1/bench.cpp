@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BufferPool.h"
+#include "HugePageResource.h"
+#include "Txt.h"
+
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings {
+        std::size_t min_size = std::size_t(1) << 10;
+        std::size_t max_size = std::size_t(4) << 30;
+        std::size_t size_factor = 4;
+        std::size_t warmup = 3;
+        std::size_t iterations = 31;
+        double seconds_per_case = 10;
+        std::string format = "json";
+        std::string output;
+        std::filesystem::path directory = std::filesystem::temp_directory_path();
+    };
+
+    struct Result {
+        std::string name;
+        std::size_t file_size;
+        std::size_t lines;
+        std::size_t iterations;
+        double median;
+        double p90;
+        double p99;
+        double mean;
+        double stddev;
+        double min;
+        double max;
+    };
+
+    // A sample is one timed run of an operation, in nanoseconds. Each
+    // operation times itself so that its setup and cleanup stay outside the
+    // measured interval.
+    using Operation = std::function<double()>;
+
+
+    double elapsed_ns(Clock::time_point begin, Clock::time_point end) {
+        return std::chrono::duration<double, std::nano>(end - begin).count();
+    }
+
+
+    // Nearest-rank percentile of an already sorted sample.
+    double percentile(const std::vector<double>& sorted, double p) {
+        const std::size_t rank = static_cast<std::size_t>(
+            std::ceil(p / 100 * sorted.size())
+        );
+
+        return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+
+    Result measure(
+        const Settings& settings,
+        const std::string& name,
+        const l1::Txt& reference,
+        const Operation& operation
+    ) {
+        for (std::size_t i = 0; i < settings.warmup; ++i) {
+            operation();
+        }
+
+        // Large files can take seconds per run; after a few samples the
+        // time budget decides whether more are worth taking.
+        const std::size_t min_iterations = std::min<std::size_t>(
+            settings.iterations, 5
+        );
+        const auto deadline = Clock::now() + std::chrono::duration_cast<
+            Clock::duration
+        >(std::chrono::duration<double>(settings.seconds_per_case));
+        std::vector<double> samples;
+        samples.reserve(settings.iterations);
+
+        while (
+            samples.size() < settings.iterations
+            && (samples.size() < min_iterations || Clock::now() < deadline)
+        ) {
+            samples.push_back(operation());
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        double sum = 0;
+        for (const double sample: samples) {
+            sum += sample;
+        }
+        const double mean = sum / samples.size();
+
+        double squares = 0;
+        for (const double sample: samples) {
+            squares += (sample - mean) * (sample - mean);
+        }
+        const double stddev = samples.size() > 1
+            ? std::sqrt(squares / (samples.size() - 1))
+            : 0;
+
+        return Result{
+            name,
+            reference.length(),
+            reference.size(),
+            samples.size(),
+            percentile(samples, 50),
+            percentile(samples, 90),
+            percentile(samples, 99),
+            mean,
+            stddev,
+            samples.front(),
+            samples.back()
+        };
+    }
+
+
+    // Writes 'size' bytes of lines with pseudo-random lengths. The seed is
+    // fixed, so every run benchmarks exactly the same content.
+    void generate_file(const std::filesystem::path& path, std::size_t size) {
+        std::ofstream file(path, std::ios_base::binary);
+        std::mt19937_64 generator(size);
+        std::vector<char> block(std::size_t(1) << 20);
+
+        for (std::size_t written = 0; written < size; ) {
+            const std::size_t n = std::min(block.size(), size - written);
+            for (std::size_t i = 0; i < n; ) {
+                const std::size_t line = std::min<std::size_t>(
+                    generator() % 120, n - i - 1
+                );
+                std::memset(block.data() + i, 'a' + generator() % 26, line);
+                i += line;
+                block[i++] = '\n';
+            }
+            file.write(block.data(), n);
+            written += n;
+        }
+    }
+
+
+    void benchmark_size(
+        const Settings& settings,
+        std::size_t size,
+        std::vector<Result>& results
+    ) {
+        const std::filesystem::path path = settings.directory
+            / ("l1-bench-" + std::to_string(size) + ".txt");
+        generate_file(path, size);
+
+        const std::string filename = path.string();
+        const l1::Txt source(filename);
+        std::optional<l1::Txt> target;
+
+        const auto load = [&](l1::LoadMode mode) {
+            return [&, mode]() {
+                const auto begin = Clock::now();
+                target.emplace(filename, mode);
+                const auto end = Clock::now();
+                target.reset();
+
+                return elapsed_ns(begin, end);
+            };
+        };
+
+        results.push_back(measure(
+            settings, "load_read", source, load(l1::LoadMode::READ)
+        ));
+        results.push_back(measure(
+            settings, "load_map", source, load(l1::LoadMode::MAP)
+        ));
+
+        results.push_back(measure(settings, "copy_construct", source, [&]() {
+            const auto begin = Clock::now();
+            target.emplace(source);
+            const auto end = Clock::now();
+            target.reset();
+
+            return elapsed_ns(begin, end);
+        }));
+
+        results.push_back(measure(settings, "copy_assign", source, [&]() {
+            l1::Txt copy;
+            const auto begin = Clock::now();
+            copy = source;
+            const auto end = Clock::now();
+
+            return elapsed_ns(begin, end);
+        }));
+
+        l1::Txt moved(filename);
+
+        results.push_back(measure(settings, "move_construct", source, [&]() {
+            const auto begin = Clock::now();
+            target.emplace(std::move(moved));
+            const auto end = Clock::now();
+            moved = std::move(*target);
+            target.reset();
+
+            return elapsed_ns(begin, end);
+        }));
+
+        results.push_back(measure(settings, "move_assign", source, [&]() {
+            l1::Txt other;
+            const auto begin = Clock::now();
+            other = std::move(moved);
+            const auto end = Clock::now();
+            moved = std::move(other);
+
+            return elapsed_ns(begin, end);
+        }));
+
+        results.push_back(measure(settings, "destroy", source, [&]() {
+            target.emplace(filename);
+            const auto begin = Clock::now();
+            target.reset();
+            const auto end = Clock::now();
+
+            return elapsed_ns(begin, end);
+        }));
+
+        // The same for READ content in memory from the other resources.
+        // An arena frees everything at once, which is part of its destroy.
+        std::pmr::monotonic_buffer_resource arena;
+        l1::BufferPool pool;
+        l1::HugePageResource huge;
+
+        const auto load_with = [&](std::pmr::memory_resource* resource) {
+            return [&, resource]() {
+                const auto begin = Clock::now();
+                target.emplace(
+                    filename,
+                    l1::LoadMode::READ,
+                    l1::Indexing::LAZY,
+                    l1::Sidecar::OFF,
+                    resource
+                );
+                const auto end = Clock::now();
+                target.reset();
+                arena.release();
+
+                return elapsed_ns(begin, end);
+            };
+        };
+
+        const auto destroy_with = [&](std::pmr::memory_resource* resource) {
+            return [&, resource]() {
+                target.emplace(
+                    filename,
+                    l1::LoadMode::READ,
+                    l1::Indexing::LAZY,
+                    l1::Sidecar::OFF,
+                    resource
+                );
+                const auto begin = Clock::now();
+                target.reset();
+                arena.release();
+                const auto end = Clock::now();
+
+                return elapsed_ns(begin, end);
+            };
+        };
+
+        // A full pass over the content, where the page size shows.
+        const auto scan_with = [&](std::pmr::memory_resource* resource) {
+            const l1::Txt txt(
+                filename,
+                l1::LoadMode::READ,
+                l1::Indexing::LAZY,
+                l1::Sidecar::OFF,
+                resource
+            );
+
+            return [txt]() {
+                const auto begin = Clock::now();
+                txt.stats();
+                const auto end = Clock::now();
+
+                return elapsed_ns(begin, end);
+            };
+        };
+
+        const std::pair<const char*, std::pmr::memory_resource*> backings[] = {
+            {"arena", &arena},
+            {"pool", &pool},
+            {"huge", &huge}
+        };
+        for (const auto& [backing, resource]: backings) {
+            results.push_back(measure(
+                settings,
+                std::string("load_read_") + backing,
+                source,
+                load_with(resource)
+            ));
+            results.push_back(measure(
+                settings,
+                std::string("destroy_") + backing,
+                source,
+                destroy_with(resource)
+            ));
+        }
+
+        results.push_back(measure(
+            settings, "scan", source, scan_with(nullptr)
+        ));
+        results.push_back(measure(
+            settings, "scan_huge", source, scan_with(&huge)
+        ));
+
+        std::filesystem::remove(path);
+    }
+
+
+    void write_json(std::ostream& out, const std::vector<Result>& results) {
+        out << std::fixed << std::setprecision(1);
+        out << "{\n  \"benchmark\": \"l1::Txt\",\n  \"unit\": \"ns\",\n"
+            << "  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << (i ? "," : "") << "\n    {"
+                << "\"name\": \"" << r.name << "\", "
+                << "\"file_size\": " << r.file_size << ", "
+                << "\"lines\": " << r.lines << ", "
+                << "\"iterations\": " << r.iterations << ", "
+                << "\"median\": " << r.median << ", "
+                << "\"p90\": " << r.p90 << ", "
+                << "\"p99\": " << r.p99 << ", "
+                << "\"mean\": " << r.mean << ", "
+                << "\"stddev\": " << r.stddev << ", "
+                << "\"min\": " << r.min << ", "
+                << "\"max\": " << r.max << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+
+    void write_csv(std::ostream& out, const std::vector<Result>& results) {
+        out << std::fixed << std::setprecision(1);
+        out << "name,file_size,lines,iterations,"
+            << "median_ns,p90_ns,p99_ns,mean_ns,stddev_ns,min_ns,max_ns\n";
+        for (const Result& r: results) {
+            out << r.name << ',' << r.file_size << ',' << r.lines << ','
+                << r.iterations << ',' << r.median << ',' << r.p90 << ','
+                << r.p99 << ',' << r.mean << ',' << r.stddev << ','
+                << r.min << ',' << r.max << '\n';
+        }
+    }
+
+
+    void print_usage(const char* program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+            << "  --min-size BYTES     smallest generated file (1024)\n"
+            << "  --max-size BYTES     largest generated file (4294967296)\n"
+            << "  --factor N           size step between files (4)\n"
+            << "  --warmup N           untimed runs per case (3)\n"
+            << "  --iterations N       timed runs per case (31)\n"
+            << "  --seconds S          time budget per case (10)\n"
+            << "  --format json|csv    output format (json)\n"
+            << "  --output FILE        write results to FILE, not stdout\n"
+            << "  --dir DIR            where to generate the files\n";
+    }
+
+
+    bool parse_arguments(int argc, char* argv[], Settings& settings) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string option = argv[i];
+            if (i + 1 == argc) {
+                return false;
+            }
+            const std::string value = argv[++i];
+
+            if (option == "--min-size") {
+                settings.min_size = std::stoull(value);
+            } else if (option == "--max-size") {
+                settings.max_size = std::stoull(value);
+            } else if (option == "--factor") {
+                settings.size_factor = std::stoull(value);
+            } else if (option == "--warmup") {
+                settings.warmup = std::stoull(value);
+            } else if (option == "--iterations") {
+                settings.iterations = std::stoull(value);
+            } else if (option == "--seconds") {
+                settings.seconds_per_case = std::stod(value);
+            } else if (option == "--format") {
+                settings.format = value;
+            } else if (option == "--output") {
+                settings.output = value;
+            } else if (option == "--dir") {
+                settings.directory = value;
+            } else {
+                return false;
+            }
+        }
+
+        return settings.min_size > 0
+            && settings.size_factor > 1
+            && settings.iterations > 0
+            && (settings.format == "json" || settings.format == "csv");
+    }
+}
+
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+
+    try {
+        if (!parse_arguments(argc, argv, settings)) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    } catch (const std::exception&) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (
+        std::size_t size = settings.min_size;
+        size <= settings.max_size;
+        size *= settings.size_factor
+    ) {
+        std::cerr << "Benchmarking " << size << " bytes..." << std::endl;
+        benchmark_size(settings, size, results);
+    }
+
+    std::ofstream file;
+    if (!settings.output.empty()) {
+        file.open(settings.output);
+    }
+    std::ostream& out = settings.output.empty() ? std::cout : file;
+
+    if (settings.format == "csv") {
+        write_csv(out, results);
+    } else {
+        write_json(out, results);
+    }
+
+    return 0;
+}
@@ -2,11 +2,49 @@
 #include <fstream>
 #include <iomanip>
 #include <chrono>
+#include <string>
+#include <vector>
 #include "Txt.h"
-#define TIMEP(start, end) (std::chrono::duration_cast<std::chrono::nanoseconds>((end) - (begin)).count())
+#include "Batch.h"
+#define TIMEP(start, end) (std::chrono::duration_cast<std::chrono::nanoseconds>((end) - (start)).count())
+
+int count_in_batch(const std::vector<std::string>& inputs)
+{
+	const l1::BatchCount count = l1::count_files(inputs);
+
+	for (const l1::FileCount& file : count.files)
+	{
+		if (file.ok)
+		{
+			std::cout << std::setw(9) << file.lines << ' '
+				<< std::setw(12) << file.chars << ' '
+				<< file.path << '\n';
+		}
+		else
+		{
+			std::cout << file.path << ": cannot be read\n";
+		}
+	}
+	std::cout << std::setw(9) << count.lines << ' '
+		<< std::setw(12) << count.chars << " total ("
+		<< count.files.size() << " files, "
+		<< count.failed << " failed)" << std::endl;
+
+	return count.failed ? 3 : 0;
+}
 
 int main(int argc, char* argv[])
 {
+	if (argc >= 2 && std::string(argv[1]) == "--batch")
+	{
+		if (argc == 2)
+		{
+			std::cout << argv[0] << ": missing file \n";
+			return 1;
+		}
+		return count_in_batch(std::vector<std::string>(argv + 2, argv + argc));
+	}
+
 	std::ofstream ofs("Lab1Output.txt");
 
 	if (argc == 1)
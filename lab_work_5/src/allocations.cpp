@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <malloc.h>
+
+#include "matrix.h"
+#include "string_matrix.h"
+
+
+// Counts the heap allocations that Matrix accumulation steps make once the
+// accumulator exists, on 512 x 512 matrices of doubles. Every step should
+// make none: the sum is computed in the accumulator's storage, or in the
+// storage of a temporary operand.
+//
+// The matrices are set to run sequentially, since a parallel run allocates
+// a few blocks for its bookkeeping, however large the matrices are.
+//
+// Then it compares the allocations that building a 1000 x 100 table of
+// labels drawn from 1000 values takes as a Matrix<std::string> and as a
+// StringMatrix, and that their elementwise concatenation takes, along with
+// the bytes the result keeps: the ones allocated less the ones freed, as
+// malloc_usable_size() reports them, so the spare capacity of a grown
+// buffer counts but the buffers it outgrew do not. These run sequentially
+// too.
+//
+// Usage: allocations [steps]
+
+namespace {
+    std::atomic<std::size_t> allocation_count(0);
+    std::atomic<std::size_t> live_bytes(0);
+
+    void* counted(void* p) {
+        if (p) {
+            ++allocation_count;
+            live_bytes += malloc_usable_size(p);
+        }
+
+        return p;
+    }
+
+    void release(void* p) {
+        if (p) {
+            live_bytes -= malloc_usable_size(p);
+            std::free(p);
+        }
+    }
+}
+
+void* operator new(std::size_t size) {
+    if (void* p = counted(std::malloc(size ? size : 1))) {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    if (
+        void* p = counted(std::aligned_alloc(
+            align, (std::max(size, std::size_t(1)) + align - 1) / align * align
+        ))
+    ) {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    release(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    release(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    release(p);
+}
+
+template<class Step>
+void report(const std::string& name, std::size_t steps, Step step);
+
+template<class Build>
+void report_labels(const std::string& name, Build build);
+
+
+int main(int argc, char* argv[]) {
+    const std::size_t steps = argc > 1
+        ? std::strtoul(argv[1], nullptr, 10)
+        : 100;
+    const std::size_t size = 512;
+
+    Matrix<double> acc(size, size);
+    Matrix<double> x(size, size);
+    Matrix<double> y(size, size);
+    for (std::size_t i = 0; i < size; ++i) {
+        for (std::size_t j = 0; j < size; ++j) {
+            x[std::make_pair(i, j)] = double(i + j) / size;
+            y[std::make_pair(i, j)] = double(i) - double(j);
+        }
+    }
+    acc.set_execution(Execution::SEQUENTIAL);
+    x.set_execution(Execution::SEQUENTIAL);
+    y.set_execution(Execution::SEQUENTIAL);
+
+    std::cout
+        << std::setw(28) << "step"
+        << std::setw(14) << "allocations"
+        << std::endl;
+
+    report("acc = acc + x", steps, [&]() {
+        acc = acc + x;
+    });
+    report("acc += x", steps, [&]() {
+        acc += x;
+    });
+    report("acc -= x", steps, [&]() {
+        acc -= x;
+    });
+    report("acc += 0.5 * x - y", steps, [&]() {
+        acc += 0.5 * x - y;
+    });
+    report("acc = std::move(acc) + x", steps, [&]() {
+        acc = std::move(acc) + x;
+    });
+    report("acc = x - std::move(acc)", steps, [&]() {
+        acc = x - std::move(acc);
+    });
+
+    // An operand moved from is left 0 x 0, so assigning to it again
+    // allocates new storage rather than writing to the storage it lost
+    Matrix<double> moved(x);
+    const Matrix<double> sum = std::move(moved) + y;
+    moved = x + y;
+    if (
+        moved.rows() != size
+        || moved.columns() != size
+        || moved(size - 1, size - 1) != sum(size - 1, size - 1)
+    ) {
+        std::cerr << "A matrix moved from cannot be assigned to" << std::endl;
+
+        return 1;
+    }
+
+    const std::size_t label_rows = 1000;
+    const std::size_t label_columns = 100;
+    std::vector<std::string> labels(1000);
+    for (std::size_t k = 0; k < labels.size(); ++k) {
+        labels[k] = "warehouse-label-" + std::to_string(k);
+    }
+    const auto label = [&](std::size_t i, std::size_t j)
+        -> const std::string& {
+        return labels[(i * 7919 + j * 104729) % labels.size()];
+    };
+
+    std::cout
+        << std::endl
+        << std::setw(28) << "labels"
+        << std::setw(14) << "allocations"
+        << std::setw(14) << "live bytes"
+        << std::endl;
+
+    Matrix<std::string> dense;
+    report_labels("Matrix<std::string>", [&]() {
+        dense = Matrix<std::string>(label_rows, label_columns);
+        dense.set_execution(Execution::SEQUENTIAL);
+        for (std::size_t i = 0; i < label_rows; ++i) {
+            for (std::size_t j = 0; j < label_columns; ++j) {
+                dense[std::make_pair(i, j)] = label(i, j);
+            }
+        }
+    });
+
+    StringMatrix arena(0, 0);
+    report_labels("StringMatrix", [&]() {
+        arena = StringMatrix(label_rows, label_columns);
+        for (std::size_t i = 0; i < label_rows; ++i) {
+            for (std::size_t j = 0; j < label_columns; ++j) {
+                arena.set(i, j, label(i, j));
+            }
+        }
+    });
+
+    StringMatrix interned(0, 0);
+    report_labels("StringMatrix, interned", [&]() {
+        interned = StringMatrix(
+            label_rows, label_columns, Interning::ENABLED
+        );
+        for (std::size_t i = 0; i < label_rows; ++i) {
+            for (std::size_t j = 0; j < label_columns; ++j) {
+                interned.set(i, j, label(i, j));
+            }
+        }
+    });
+
+    Matrix<std::string> dense_sum;
+    dense_sum.set_execution(Execution::SEQUENTIAL);
+    report_labels("Matrix<std::string> a + b", [&]() {
+        dense_sum = dense + dense;
+    });
+    StringMatrix arena_sum(0, 0);
+    report_labels("StringMatrix a + b", [&]() {
+        arena_sum = arena.concatenate(arena, Execution::SEQUENTIAL);
+    });
+
+    return 0;
+}
+
+
+template<class Step>
+void report(const std::string& name, std::size_t steps, Step step) {
+    // The first step may size the accumulator
+    step();
+
+    const std::size_t before = allocation_count;
+    for (std::size_t i = 0; i < steps; ++i) {
+        step();
+    }
+    const std::size_t allocations = allocation_count - before;
+
+    std::cout
+        << std::setw(28) << name
+        << std::setw(14) << allocations
+        << std::endl;
+}
+
+template<class Build>
+void report_labels(const std::string& name, Build build) {
+    const std::size_t count = allocation_count;
+    const std::size_t bytes = live_bytes;
+    build();
+
+    std::cout
+        << std::setw(28) << name
+        << std::setw(14) << allocation_count - count
+        << std::setw(14) << live_bytes - bytes
+        << std::endl;
+}
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "matrix.h"
+
+
+// Compares Matrix multiplication with the textbook triple loop on square
+// matrices of doubles from 64 x 64 to 4096 x 4096.
+//
+// Usage: benchmark [largest size for the triple loop]
+//
+// The triple loop is skipped for sizes above 1024 by default, since it takes
+// minutes at 4096.
+
+template<class T>
+Matrix<T> random_matrix(std::size_t size, std::mt19937& generator);
+
+template<class T>
+Matrix<T> multiply_naively(const Matrix<T>& a, const Matrix<T>& b);
+
+template<class Function>
+double measure_seconds(Function function);
+
+
+int main(int argc, char* argv[]) {
+    const std::size_t naive_limit = argc > 1
+        ? std::strtoul(argv[1], nullptr, 10)
+        : 1024;
+
+    std::mt19937 generator(42);
+
+    std::cout
+        << std::setw(6) << "size"
+        << std::setw(14) << "naive, ms"
+        << std::setw(14) << "gemm, ms"
+        << std::setw(14) << "gemm, GFLOPS"
+        << std::setw(10) << "speedup"
+        << std::endl;
+
+    for (std::size_t size = 64; size <= 4096; size *= 2) {
+        const Matrix<double> a = random_matrix<double>(size, generator);
+        const Matrix<double> b = random_matrix<double>(size, generator);
+        Matrix<double> c(size, size);
+
+        // Small sizes are repeated to get past the timer resolution
+        const std::size_t repetitions = std::max<std::size_t>(
+            (std::size_t(256) << 20) / (size * size * size), 1
+        );
+
+        const double gemm_seconds = measure_seconds(
+            [&]() {
+                for (std::size_t i = 0; i < repetitions; ++i) {
+                    gemm(1.0, a, b, 0.0, c);
+                }
+            }
+        ) / repetitions;
+        const double gflops = 2.0 * size * size * size / gemm_seconds / 1e9;
+
+        std::cout
+            << std::setw(6) << size
+            << std::fixed << std::setprecision(3);
+
+        if (size <= naive_limit) {
+            const double naive_seconds = measure_seconds(
+                [&]() {
+                    multiply_naively(a, b);
+                }
+            );
+
+            std::cout
+                << std::setw(14) << naive_seconds * 1e3
+                << std::setw(14) << gemm_seconds * 1e3
+                << std::setw(14) << gflops
+                << std::setw(10) << naive_seconds / gemm_seconds;
+        } else {
+            std::cout
+                << std::setw(14) << "-"
+                << std::setw(14) << gemm_seconds * 1e3
+                << std::setw(14) << gflops
+                << std::setw(10) << "-";
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
+
+
+template<class T>
+Matrix<T> random_matrix(std::size_t size, std::mt19937& generator) {
+    std::uniform_real_distribution<T> distribution(-1, 1);
+
+    Matrix<T> matrix(size, size);
+    for (std::size_t i = 0; i < size; ++i) {
+        for (std::size_t j = 0; j < size; ++j) {
+            matrix[std::make_pair(i, j)] = distribution(generator);
+        }
+    }
+
+    return matrix;
+}
+
+template<class T>
+Matrix<T> multiply_naively(const Matrix<T>& a, const Matrix<T>& b) {
+    const std::size_t m = a.size(Matrix<T>::Dimension::ROW);
+    const std::size_t n = b.size(Matrix<T>::Dimension::COLUMN);
+    const std::size_t k = a.size(Matrix<T>::Dimension::COLUMN);
+
+    Matrix<T> c(m, n);
+    for (std::size_t i = 0; i < m; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            T sum = T();
+            for (std::size_t p = 0; p < k; ++p) {
+                sum += a[std::make_pair(i, p)] * b[std::make_pair(p, j)];
+            }
+            c[std::make_pair(i, j)] = sum;
+        }
+    }
+
+    return c;
+}
+
+template<class Function>
+double measure_seconds(Function function) {
+    const auto start = std::chrono::steady_clock::now();
+    function();
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
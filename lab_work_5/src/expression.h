@@ -0,0 +1,262 @@
+#ifndef EXPRESSION_H_INCLUDED
+#define EXPRESSION_H_INCLUDED
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+#include "kernels.h"
+#include "utilities.h"
+
+
+// Expression templates: 'a + b - c' does not compute anything, it builds a
+// tree of lightweight nodes that refer to the operands. The tree is
+// evaluated element by element in a single pass when it is assigned to a
+// Matrix, so no intermediate matrices are allocated.
+//
+// Sizes are checked as the tree is built, so a mismatch throws right at
+// the offending operator.
+//
+// Nodes refer to the matrices in them, so an expression must not outlive
+// its operands. A temporary Matrix is therefore never put in a tree: an
+// operator given one computes its result right away, in the temporary.
+//
+// For the types the SIMD kernels handle, a tree is evaluated a block of
+// elements at a time rather than element by element: every node turns the
+// blocks of its operands into its own with one kernel call, and 'a * k + b'
+// becomes a single fused multiply-add.
+
+template<class E, class Operation, class F>
+class MatrixBinaryExpression;
+
+template<class E>
+class MatrixScaledExpression;
+
+// The number of elements in a block
+constexpr std::size_t MATRIX_BLOCK_SIZE = 256;
+
+// The way a node holds its operands: nodes are small and copied, anything
+// else (a Matrix) is referred to
+template<class E>
+struct MatrixOperand {
+    using type = E;
+};
+
+// Whether elements of type T can be scaled by a factor of type U. A
+// fractional factor for integral elements cannot: 'Matrix<int> * 0.5' would
+// scale by 0. Other conversions, like 'Matrix<float> * 0.5' or
+// 'Matrix<short> * 2', keep the value of the factor.
+template<class U, class T>
+struct is_exact_factor
+    : std::integral_constant<
+        bool,
+        !(std::is_floating_point<U>::value && std::is_integral<T>::value)
+    >
+{};
+
+// The base of everything that can appear in an expression. 'E' is the
+// derived class, which provides value_type, rows(), columns() and
+// operator()(row, column).
+template<class E>
+class MatrixExpression {
+public:
+    using size_type = std::size_t;
+
+    const E& self() const {
+        return static_cast<const E&>(*this);
+    }
+
+    template<class F>
+    MatrixBinaryExpression<E, Sum, F> operator+(
+        const MatrixExpression<F>& other
+    ) const {
+        return MatrixBinaryExpression<E, Sum, F>(this->self(), other.self());
+    }
+
+    template<class F>
+    MatrixBinaryExpression<E, Difference, F> operator-(
+        const MatrixExpression<F>& other
+    ) const {
+        return MatrixBinaryExpression<E, Difference, F>(
+            this->self(), other.self()
+        );
+    }
+
+    template<
+        class U,
+        std::enable_if_t<std::is_arithmetic<U>::value, bool> = true
+    >
+    MatrixScaledExpression<E> operator*(const U& factor) const {
+        static_assert(
+            is_exact_factor<U, typename E::value_type>::value,
+            "The factor would be narrowed to the element type"
+        );
+
+        return MatrixScaledExpression<E>(this->self(), factor);
+    }
+};
+
+template<
+    class U,
+    class E,
+    std::enable_if_t<std::is_arithmetic<U>::value, bool> = true
+>
+MatrixScaledExpression<E> operator*(
+    const U& factor, const MatrixExpression<E>& expression
+) {
+    static_assert(
+        is_exact_factor<U, typename E::value_type>::value,
+        "The factor would be narrowed to the element type"
+    );
+
+    return MatrixScaledExpression<E>(expression.self(), factor);
+}
+
+template<class E>
+struct is_scaled_expression : std::false_type {};
+
+template<class E>
+struct is_scaled_expression<MatrixScaledExpression<E>> : std::true_type {};
+
+template<class E, class Operation, class F>
+class MatrixBinaryExpression
+    : public MatrixExpression<MatrixBinaryExpression<E, Operation, F>>
+{
+public:
+    using value_type = typename E::value_type;
+    using size_type = std::size_t;
+
+    size_type rows() const {
+        return this->_left.rows();
+    }
+
+    size_type columns() const {
+        return this->_left.columns();
+    }
+
+    value_type operator()(size_type row, size_type column) const {
+        return Operation()(
+            this->_left(row, column), this->_right(row, column)
+        );
+    }
+
+    // Evaluates the elements [offset, offset + n) of the storage (padding
+    // included) into 'out', or returns where they already are
+    const value_type* block(
+        size_type offset, size_type n, value_type* out
+    ) const {
+        alignas(CACHE_LINE_SIZE) value_type left[MATRIX_BLOCK_SIZE];
+        alignas(CACHE_LINE_SIZE) value_type right[MATRIX_BLOCK_SIZE];
+
+        if constexpr (
+            std::is_same<Operation, Sum>::value
+            && is_scaled_expression<E>::value
+        ) {
+            kernels::multiply_add(
+                this->_left.operand().block(offset, n, left),
+                this->_left.factor(),
+                this->_right.block(offset, n, right),
+                out,
+                n
+            );
+        } else if constexpr (
+            std::is_same<Operation, Sum>::value
+            && is_scaled_expression<F>::value
+        ) {
+            kernels::multiply_add(
+                this->_right.operand().block(offset, n, right),
+                this->_right.factor(),
+                this->_left.block(offset, n, left),
+                out,
+                n
+            );
+        } else if constexpr (std::is_same<Operation, Sum>::value) {
+            kernels::add(
+                this->_left.block(offset, n, left),
+                this->_right.block(offset, n, right),
+                out,
+                n
+            );
+        } else {
+            kernels::subtract(
+                this->_left.block(offset, n, left),
+                this->_right.block(offset, n, right),
+                out,
+                n
+            );
+        }
+
+        return out;
+    }
+
+    MatrixBinaryExpression(const E& left, const F& right)
+    :
+        _left(left),
+        _right(right)
+    {
+        if (
+            left.rows() != right.rows()
+            ||
+            left.columns() != right.columns()
+        ) {
+            throw std::length_error("Matrix sizes do not match");
+        }
+    }
+
+private:
+    typename MatrixOperand<E>::type _left;
+    typename MatrixOperand<F>::type _right;
+};
+
+template<class E>
+class MatrixScaledExpression
+    : public MatrixExpression<MatrixScaledExpression<E>>
+{
+public:
+    using value_type = typename E::value_type;
+    using size_type = std::size_t;
+
+    size_type rows() const {
+        return this->_operand.rows();
+    }
+
+    size_type columns() const {
+        return this->_operand.columns();
+    }
+
+    value_type operator()(size_type row, size_type column) const {
+        return this->_operand(row, column) * this->_factor;
+    }
+
+    const E& operand() const {
+        return this->_operand;
+    }
+
+    value_type factor() const {
+        return this->_factor;
+    }
+
+    // The operand is evaluated straight into 'out': nothing else reads the
+    // block after it
+    const value_type* block(
+        size_type offset, size_type n, value_type* out
+    ) const {
+        kernels::scale(
+            this->_operand.block(offset, n, out), this->_factor, out, n
+        );
+
+        return out;
+    }
+
+    MatrixScaledExpression(const E& operand, value_type factor)
+    :
+        _operand(operand),
+        _factor(factor)
+    {}
+
+private:
+    typename MatrixOperand<E>::type _operand;
+    value_type _factor;
+};
+
+#endif // EXPRESSION_H_INCLUDED
@@ -0,0 +1,263 @@
+#ifndef FIXED_MATRIX_H_INCLUDED
+#define FIXED_MATRIX_H_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "matrix.h"
+#include "utilities.h"
+
+
+// Up to this many elements, the loops of a fixed-size matrix are unrolled
+// at compile time
+constexpr std::size_t FIXED_MATRIX_UNROLL_LIMIT = 256;
+
+// A matrix whose size is part of its type. The elements are held in the
+// object itself, so there are no allocations and a small matrix lives on
+// the stack, and arithmetic is constexpr. Adding matrices of different
+// sizes, or multiplying ones that do not fit, does not compile.
+template<class T, std::size_t Rows, std::size_t Columns>
+class Matrix {
+    static_assert(
+        Rows != DYNAMIC_SIZE && Columns != DYNAMIC_SIZE,
+        "Either both sizes of a Matrix are set at compile time or none is"
+    );
+
+public:
+    using value_type = T;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using size_type = std::size_t;
+    using index_type = std::pair<size_type, size_type>;
+    // Row by row, with no padding
+    using storage_type = std::array<value_type, Rows * Columns>;
+
+    // Static, so that the matrix is exactly the size of its elements
+    static constexpr std::integral_constant<size_type, 2> rank{};
+
+    enum class Dimension {
+        ROW,
+        COLUMN
+    };
+
+    constexpr size_type size(Dimension dimension) const {
+        switch (dimension) {
+            case Dimension::ROW:
+                return Rows;
+            break;
+            case Dimension::COLUMN:
+                return Columns;
+            break;
+            default:
+                throw std::invalid_argument(
+                    "An invalid value was passed for parameter 'dimension'"
+                );
+        }
+    }
+
+    constexpr size_type rows() const {
+        return Rows;
+    }
+
+    constexpr size_type columns() const {
+        return Columns;
+    }
+
+    template<class Compare = std::less<const_reference>>
+    void sort(
+        Dimension dimension,
+        size_type index,
+        Compare comp = std::less<const_reference>()
+    ) {
+        switch (dimension) {
+            case Dimension::ROW: {
+                auto row = this->_elements.begin() + index * Columns;
+                std::sort(row, row + Columns, comp);
+            }
+            break;
+            case Dimension::COLUMN: {
+                std::array<value_type, Rows> tmp;
+
+                for (size_type i = 0; i < Rows; ++i) {
+                    tmp[i] = std::move(this->_elements[i * Columns + index]);
+                }
+
+                std::sort(tmp.begin(), tmp.end(), comp);
+
+                for (size_type i = 0; i < Rows; ++i) {
+                    this->_elements[i * Columns + index] = std::move(tmp[i]);
+                }
+            }
+            break;
+            default:
+                throw std::invalid_argument(
+                    "An invalid value was passed for parameter 'dimension'"
+                );
+        }
+    }
+
+    constexpr reference operator[](index_type index) {
+        return this->_elements[index.first * Columns + index.second];
+    }
+
+    constexpr const_reference operator[](index_type index) const {
+        return this->_elements[index.first * Columns + index.second];
+    }
+
+    constexpr const_reference operator()(
+        size_type row, size_type column
+    ) const {
+        return this->_elements[row * Columns + column];
+    }
+
+    template<std::size_t OtherRows, std::size_t OtherColumns>
+    constexpr Matrix operator+(
+        const Matrix<T, OtherRows, OtherColumns>& other
+    ) const {
+        static_assert(
+            OtherRows == Rows && OtherColumns == Columns,
+            "Matrix sizes do not match"
+        );
+
+        return this->_combine(other, Sum());
+    }
+
+    template<std::size_t OtherRows, std::size_t OtherColumns>
+    constexpr Matrix operator-(
+        const Matrix<T, OtherRows, OtherColumns>& other
+    ) const {
+        static_assert(
+            OtherRows == Rows && OtherColumns == Columns,
+            "Matrix sizes do not match"
+        );
+
+        return this->_combine(other, Difference());
+    }
+
+    template<
+        class U,
+        std::enable_if_t<
+            std::is_arithmetic<U>::value || std::is_same<U, T>::value,
+            bool
+        > = true
+    >
+    constexpr Matrix operator*(const U& factor) const {
+        static_assert(
+            is_exact_factor<U, T>::value,
+            "The factor would be narrowed to the element type"
+        );
+
+        Matrix result;
+        _repeat<Rows * Columns>([&](size_type i) {
+            result._elements[i] = value_type(this->_elements[i] * factor);
+        });
+
+        return result;
+    }
+
+    template<std::size_t OtherRows, std::size_t OtherColumns>
+    constexpr Matrix<T, Rows, OtherColumns> operator*(
+        const Matrix<T, OtherRows, OtherColumns>& other
+    ) const {
+        static_assert(OtherRows == Columns, "Matrix sizes do not match");
+
+        Matrix<T, Rows, OtherColumns> result;
+        _repeat<Rows * OtherColumns>([&](size_type i) {
+            const size_type row = i / OtherColumns;
+            const size_type column = i % OtherColumns;
+
+            value_type element = value_type();
+            _repeat<Columns>([&](size_type p) {
+                element += (*this)(row, p) * other(p, column);
+            });
+            result[std::make_pair(row, column)] = element;
+        });
+
+        return result;
+    }
+
+    // A matrix of value_type()
+    constexpr Matrix()
+    :
+        _elements()
+    {}
+
+    // One braced list per row, e.g. Matrix<int, 2, 3> {{1, 2, 3}, {4, 5, 6}}
+    template<std::size_t... Lengths>
+    constexpr Matrix(const value_type (&... rows)[Lengths])
+    :
+        _elements()
+    {
+        static_assert(
+            sizeof...(Lengths) == Rows && ((Lengths == Columns) && ...),
+            "Matrix sizes do not match"
+        );
+
+        size_type i = 0;
+        (this->_set_row(i++, rows), ...);
+    }
+
+private:
+    template<class Operation>
+    constexpr Matrix _combine(
+        const Matrix& other, Operation operation
+    ) const {
+        Matrix result;
+        _repeat<Rows * Columns>([&](size_type i) {
+            result._elements[i] = operation(
+                this->_elements[i], other._elements[i]
+            );
+        });
+
+        return result;
+    }
+
+    constexpr void _set_row(size_type i, const value_type (&row)[Columns]) {
+        for (size_type j = 0; j < Columns; ++j) {
+            this->_elements[i * Columns + j] = row[j];
+        }
+    }
+
+    // Calls function(i) for i in [0, N), unrolled if N is small enough
+    template<std::size_t N, class Function>
+    static constexpr void _repeat(Function function) {
+        if constexpr (N <= FIXED_MATRIX_UNROLL_LIMIT) {
+            _repeat(function, std::make_index_sequence<N>());
+        } else {
+            for (size_type i = 0; i < N; ++i) {
+                function(i);
+            }
+        }
+    }
+
+    template<class Function, std::size_t... I>
+    static constexpr void _repeat(
+        Function function, std::index_sequence<I...>
+    ) {
+        (function(I), ...);
+    }
+
+    storage_type _elements;
+};
+
+template<
+    class U,
+    class T,
+    std::size_t Rows,
+    std::size_t Columns,
+    std::enable_if_t<
+        std::is_arithmetic<U>::value && Rows != DYNAMIC_SIZE,
+        bool
+    > = true
+>
+constexpr Matrix<T, Rows, Columns> operator*(
+    const U& factor, const Matrix<T, Rows, Columns>& matrix
+) {
+    return matrix * factor;
+}
+
+#endif // FIXED_MATRIX_H_INCLUDED
@@ -0,0 +1,377 @@
+#ifndef GEMM_H_INCLUDED
+#define GEMM_H_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "kernels.h"
+#include "parallel.h"
+#include "utilities.h"
+
+
+// General matrix multiplication, C = alpha * A * B + beta * C, on row-major
+// arrays, following the GotoBLAS / BLIS scheme:
+//
+// - B is cut into kc x nc blocks, and each block is packed into panels of
+//   nr columns that are laid out the way the micro-kernel reads them;
+// - A is cut into mc x kc blocks packed into panels of mr rows (scaled by
+//   alpha on the way);
+// - the micro-kernel multiplies an mr-row panel of A by an nr-column panel
+//   of B into an mr x nr tile of C that it keeps in registers.
+//
+// kc is chosen so that a panel of B stays in L1, mc so that a block of A
+// stays in L2 and nc so that a block of B stays in L3. The rows of C are
+// split between the threads of the shared pool.
+namespace kernels {
+    // Cache sizes the blocking is planned for. Only half of each is used,
+    // to leave room for the data that is streamed through.
+    constexpr std::size_t GEMM_L1_SIZE = std::size_t(32) << 10;
+    constexpr std::size_t GEMM_L2_SIZE = std::size_t(512) << 10;
+    constexpr std::size_t GEMM_L3_SIZE = std::size_t(4) << 20;
+
+    // Products smaller than this (in multiply-adds) are not worth packing
+    constexpr std::size_t GEMM_SMALL_SIZE = std::size_t(32) * 32 * 32;
+
+    // The least number of multiply-adds that is worth a thread
+    constexpr std::size_t GEMM_MIN_WORK_PER_THREAD = std::size_t(1) << 24;
+
+    // Adds the product of an mr-row panel of A and an nr-column panel of B,
+    // both 'kc' long, to the tile at 'c'
+    template<class T>
+    using GemmMicroKernel = void (*)(
+        std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc
+    );
+
+    template<class T>
+    struct GemmKernel {
+        std::size_t mr;
+        std::size_t nr;
+        GemmMicroKernel<T> run;
+    };
+
+    template<class T>
+    void gemm_micro_scalar(
+        std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc
+    ) {
+        const std::size_t mr = 4;
+        const std::size_t nr = 4;
+
+        T acc[mr][nr] = {};
+        for (std::size_t p = 0; p < kc; ++p) {
+            for (std::size_t i = 0; i < mr; ++i) {
+                for (std::size_t j = 0; j < nr; ++j) {
+                    acc[i][j] += a[p * mr + i] * b[p * nr + j];
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < mr; ++i) {
+            for (std::size_t j = 0; j < nr; ++j) {
+                c[i * ldc + j] += acc[i][j];
+            }
+        }
+    }
+
+#ifdef __GNUC__
+    // A tile of MR rows and two vectors of columns, the accumulators of
+    // which all live in registers. Like run_vector(), it is inlined into
+    // the functions below to be compiled for their instruction sets.
+    template<std::size_t Bytes, std::size_t MR, class T>
+    __attribute__((always_inline)) inline void gemm_micro_vector(
+        std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc
+    ) {
+        typedef T Vector __attribute__((vector_size(Bytes)));
+        const std::size_t lanes = Bytes / sizeof(T);
+
+        Vector acc[MR][2];
+#pragma GCC unroll 16
+        for (std::size_t i = 0; i < MR; ++i) {
+            acc[i][0] = Vector{};
+            acc[i][1] = Vector{};
+        }
+
+        for (std::size_t p = 0; p < kc; ++p) {
+            Vector b0;
+            Vector b1;
+            std::memcpy(&b0, b + p * 2 * lanes, Bytes);
+            std::memcpy(&b1, b + p * 2 * lanes + lanes, Bytes);
+#pragma GCC unroll 16
+            for (std::size_t i = 0; i < MR; ++i) {
+                const T x = a[p * MR + i];
+                acc[i][0] += x * b0;
+                acc[i][1] += x * b1;
+            }
+        }
+
+#pragma GCC unroll 16
+        for (std::size_t i = 0; i < MR; ++i) {
+            Vector c0;
+            Vector c1;
+            std::memcpy(&c0, c + i * ldc, Bytes);
+            std::memcpy(&c1, c + i * ldc + lanes, Bytes);
+            c0 += acc[i][0];
+            c1 += acc[i][1];
+            std::memcpy(c + i * ldc, &c0, Bytes);
+            std::memcpy(c + i * ldc + lanes, &c1, Bytes);
+        }
+    }
+
+    // 16 registers: 8 accumulators
+    template<class T>
+    void gemm_micro_baseline(
+        std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc
+    ) {
+        gemm_micro_vector<16, 4>(kc, a, b, c, ldc);
+    }
+#endif
+
+#ifdef LAB5_X86
+    // 16 registers: 12 accumulators
+    template<class T>
+    __attribute__((target("avx2,fma")))
+    void gemm_micro_avx2(
+        std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc
+    ) {
+        gemm_micro_vector<32, 6>(kc, a, b, c, ldc);
+    }
+
+    // 32 registers: 24 accumulators
+    template<class T>
+    __attribute__((target("avx512f")))
+    void gemm_micro_avx512(
+        std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc
+    ) {
+        gemm_micro_vector<64, 12>(kc, a, b, c, ldc);
+    }
+#endif
+
+    template<class T>
+    GemmKernel<T> select_gemm_kernel() {
+        if constexpr (is_vectorized<T>::value) {
+#ifdef LAB5_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return {12, 2 * 64 / sizeof(T), gemm_micro_avx512<T>};
+            }
+            if (
+                __builtin_cpu_supports("avx2")
+                && __builtin_cpu_supports("fma")
+            ) {
+                return {6, 2 * 32 / sizeof(T), gemm_micro_avx2<T>};
+            }
+#endif
+#ifdef __GNUC__
+            return {4, 2 * 16 / sizeof(T), gemm_micro_baseline<T>};
+#endif
+        }
+
+        return {4, 4, gemm_micro_scalar<T>};
+    }
+
+    // Packs the first 'rows' x 'kc' elements of 'a' into panels of 'mr'
+    // rows, each stored column by column, multiplied by 'alpha'. The last
+    // panel is padded with zeros.
+    template<class T>
+    void gemm_pack_a(
+        const T* a,
+        std::size_t lda,
+        std::size_t rows,
+        std::size_t kc,
+        std::size_t mr,
+        T alpha,
+        T* packed
+    ) {
+        for (std::size_t i = 0; i < rows; i += mr) {
+            const std::size_t height = std::min(mr, rows - i);
+            for (std::size_t p = 0; p < kc; ++p) {
+                for (std::size_t r = 0; r < height; ++r) {
+                    packed[r] = alpha * a[(i + r) * lda + p];
+                }
+                std::fill(packed + height, packed + mr, T());
+                packed += mr;
+            }
+        }
+    }
+
+    // Packs the first 'kc' x 'columns' elements of 'b' into panels of 'nr'
+    // columns, each stored row by row. The last panel is padded with zeros.
+    template<class T>
+    void gemm_pack_b(
+        const T* b,
+        std::size_t ldb,
+        std::size_t kc,
+        std::size_t columns,
+        std::size_t nr,
+        T* packed
+    ) {
+        for (std::size_t j = 0; j < columns; j += nr) {
+            const std::size_t width = std::min(nr, columns - j);
+            for (std::size_t p = 0; p < kc; ++p) {
+                std::copy(b + p * ldb + j, b + p * ldb + j + width, packed);
+                std::fill(packed + width, packed + nr, T());
+                packed += nr;
+            }
+        }
+    }
+
+    // C += alpha * A * B for one thread's rows
+    template<class T>
+    void gemm_serial(
+        const GemmKernel<T>& kernel,
+        std::size_t m,
+        std::size_t n,
+        std::size_t k,
+        T alpha,
+        const T* a,
+        std::size_t lda,
+        const T* b,
+        std::size_t ldb,
+        T* c,
+        std::size_t ldc
+    ) {
+        const std::size_t mr = kernel.mr;
+        const std::size_t nr = kernel.nr;
+        const std::size_t kc = std::max<std::size_t>(
+            GEMM_L1_SIZE / 2 / (nr * sizeof(T)), 1
+        );
+        const std::size_t mc = std::max<std::size_t>(
+            GEMM_L2_SIZE / 2 / (kc * sizeof(T)) / mr, 1
+        ) * mr;
+        const std::size_t nc = std::max<std::size_t>(
+            GEMM_L3_SIZE / 2 / (kc * sizeof(T)) / nr, 1
+        ) * nr;
+
+        std::vector<T, AlignedAllocator<T>> packed_a(
+            std::min(mc, (m + mr - 1) / mr * mr) * std::min(kc, k)
+        );
+        std::vector<T, AlignedAllocator<T>> packed_b(
+            std::min(nc, (n + nr - 1) / nr * nr) * std::min(kc, k)
+        );
+        std::vector<T, AlignedAllocator<T>> edge(mr * nr);
+
+        for (std::size_t jc = 0; jc < n; jc += nc) {
+            const std::size_t columns = std::min(nc, n - jc);
+            for (std::size_t pc = 0; pc < k; pc += kc) {
+                const std::size_t depth = std::min(kc, k - pc);
+                gemm_pack_b(
+                    b + pc * ldb + jc, ldb, depth, columns, nr, packed_b.data()
+                );
+
+                for (std::size_t ic = 0; ic < m; ic += mc) {
+                    const std::size_t rows = std::min(mc, m - ic);
+                    gemm_pack_a(
+                        a + ic * lda + pc,
+                        lda,
+                        rows,
+                        depth,
+                        mr,
+                        alpha,
+                        packed_a.data()
+                    );
+
+                    for (std::size_t jr = 0; jr < columns; jr += nr) {
+                        const std::size_t width = std::min(nr, columns - jr);
+                        const T* panel_b = packed_b.data() + jr * depth;
+
+                        for (std::size_t ir = 0; ir < rows; ir += mr) {
+                            const std::size_t height = std::min(mr, rows - ir);
+                            const T* panel_a = packed_a.data() + ir * depth;
+                            T* tile = c + (ic + ir) * ldc + jc + jr;
+
+                            if (height == mr && width == nr) {
+                                kernel.run(depth, panel_a, panel_b, tile, ldc);
+                                continue;
+                            }
+
+                            // A partial tile is computed aside, so that the
+                            // micro-kernel does not run past the edges of C
+                            std::fill(edge.begin(), edge.end(), T());
+                            kernel.run(
+                                depth, panel_a, panel_b, edge.data(), nr
+                            );
+                            for (std::size_t i = 0; i < height; ++i) {
+                                for (std::size_t j = 0; j < width; ++j) {
+                                    tile[i * ldc + j] += edge[i * nr + j];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // C = alpha * A * B + beta * C, where A is m x k, B is k x n, C is m x n,
+    // and ld* are the distances between the starts of rows. C must not
+    // overlap A or B.
+    template<class T>
+    void gemm(
+        std::size_t m,
+        std::size_t n,
+        std::size_t k,
+        T alpha,
+        const T* a,
+        std::size_t lda,
+        const T* b,
+        std::size_t ldb,
+        T beta,
+        T* c,
+        std::size_t ldc,
+        Execution execution = Execution::AUTOMATIC
+    ) {
+        // With beta == 0, C may hold anything, NaN included
+        for (std::size_t i = 0; i < m; ++i) {
+            if (beta == T()) {
+                std::fill(c + i * ldc, c + i * ldc + n, T());
+            } else if (beta != T(1)) {
+                scale(c + i * ldc, beta, c + i * ldc, n);
+            }
+        }
+
+        if (m * n * k <= GEMM_SMALL_SIZE) {
+            for (std::size_t i = 0; i < m; ++i) {
+                for (std::size_t p = 0; p < k; ++p) {
+                    const T x = alpha * a[i * lda + p];
+                    for (std::size_t j = 0; j < n; ++j) {
+                        c[i * ldc + j] += x * b[p * ldb + j];
+                    }
+                }
+            }
+
+            return;
+        }
+
+        static const GemmKernel<T> kernel = select_gemm_kernel<T>();
+
+        // Threads take bands of whole mr-row panels, so that they never
+        // share a tile of C
+        const std::size_t panels = (m + kernel.mr - 1) / kernel.mr;
+        const std::size_t panel_work = kernel.mr * n * k;
+
+        parallel_for(
+            panels,
+            GEMM_MIN_WORK_PER_THREAD / panel_work + 1,
+            execution,
+            [&](std::size_t begin, std::size_t end) {
+                const std::size_t start = begin * kernel.mr;
+                gemm_serial(
+                    kernel,
+                    std::min(end * kernel.mr, m) - start,
+                    n,
+                    k,
+                    alpha,
+                    a + start * lda,
+                    lda,
+                    b,
+                    ldb,
+                    c + start * ldc,
+                    ldc
+                );
+            }
+        );
+    }
+}
+
+#endif // GEMM_H_INCLUDED
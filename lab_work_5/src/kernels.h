@@ -0,0 +1,196 @@
+#ifndef KERNELS_H_INCLUDED
+#define KERNELS_H_INCLUDED
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LAB5_X86 1
+#endif
+
+
+// Elementwise loops over runs of int, float and double, written with GCC
+// vector extensions so that each iteration handles a whole SIMD register.
+// Every kernel is compiled for AVX-512, AVX2 and the baseline 16-byte
+// vectors (SSE2 on x86), and the widest one the processor supports is
+// picked on the first call. Other types go through a plain loop.
+//
+// Each kernel reads element i of its inputs before writing element i of
+// 'out', so 'out' may be one of the inputs.
+namespace kernels {
+    template<class T>
+    struct is_vectorized
+        : std::integral_constant<
+            bool,
+            std::is_same<T, int>::value
+            || std::is_same<T, float>::value
+            || std::is_same<T, double>::value
+        >
+    {};
+
+    // The operations work on single elements and on vectors alike. They
+    // write through a reference rather than returning, since returning a
+    // vector wider than the baseline ISA changes the ABI.
+    struct Add {
+        template<class V>
+        void operator()(V& z, const V& x, const V& y) const {
+            z = x + y;
+        }
+    };
+
+    struct Subtract {
+        template<class V>
+        void operator()(V& z, const V& x, const V& y) const {
+            z = x - y;
+        }
+    };
+
+    template<class T>
+    struct Scale {
+        T factor;
+
+        template<class V>
+        void operator()(V& z, const V& x, const V&) const {
+            z = x * this->factor;
+        }
+    };
+
+    // Contracted to a fused multiply-add instruction for float and double
+    // where the processor has one
+    template<class T>
+    struct MultiplyAdd {
+        T factor;
+
+        template<class V>
+        void operator()(V& z, const V& x, const V& y) const {
+            z = x * this->factor + y;
+        }
+    };
+
+    template<class T, class Operation>
+    void run_scalar(
+        const T* a, const T* b, T* out, std::size_t n, Operation operation
+    ) {
+        for (std::size_t i = 0; i < n; ++i) {
+            operation(out[i], a[i], b[i]);
+        }
+    }
+
+#ifdef __GNUC__
+    // The loop shared by all widths. It is inlined into the functions below,
+    // which is where it gets the instruction set to compile for.
+    template<std::size_t Bytes, class T, class Operation>
+    __attribute__((always_inline)) inline void run_vector(
+        const T* a, const T* b, T* out, std::size_t n, Operation operation
+    ) {
+        typedef T Vector __attribute__((vector_size(Bytes)));
+        const std::size_t lanes = Bytes / sizeof(T);
+
+        std::size_t i = 0;
+        for (; i + lanes <= n; i += lanes) {
+            Vector x;
+            Vector y;
+            Vector z;
+            std::memcpy(&x, a + i, Bytes);
+            std::memcpy(&y, b + i, Bytes);
+            operation(z, x, y);
+            std::memcpy(out + i, &z, Bytes);
+        }
+        for (; i < n; ++i) {
+            operation(out[i], a[i], b[i]);
+        }
+    }
+
+    template<class T, class Operation>
+    void run_baseline(
+        const T* a, const T* b, T* out, std::size_t n, Operation operation
+    ) {
+        run_vector<16>(a, b, out, n, operation);
+    }
+#endif
+
+#ifdef LAB5_X86
+    template<class T, class Operation>
+    __attribute__((target("avx2,fma")))
+    void run_avx2(
+        const T* a, const T* b, T* out, std::size_t n, Operation operation
+    ) {
+        run_vector<32>(a, b, out, n, operation);
+    }
+
+    template<class T, class Operation>
+    __attribute__((target("avx512f")))
+    void run_avx512(
+        const T* a, const T* b, T* out, std::size_t n, Operation operation
+    ) {
+        run_vector<64>(a, b, out, n, operation);
+    }
+#endif
+
+    template<class T, class Operation>
+    using Kernel = void (*)(const T*, const T*, T*, std::size_t, Operation);
+
+    template<class T, class Operation>
+    Kernel<T, Operation> select_kernel() {
+#ifdef LAB5_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return run_avx512<T, Operation>;
+        }
+        if (
+            __builtin_cpu_supports("avx2")
+            && __builtin_cpu_supports("fma")
+        ) {
+            return run_avx2<T, Operation>;
+        }
+#endif
+#ifdef __GNUC__
+        return run_baseline<T, Operation>;
+#else
+        return run_scalar<T, Operation>;
+#endif
+    }
+
+    // out[i] = operation(a[i], b[i]) for i < n
+    template<class T, class Operation>
+    void run(
+        const T* a, const T* b, T* out, std::size_t n, Operation operation
+    ) {
+        if constexpr (is_vectorized<T>::value) {
+            static const Kernel<T, Operation> kernel = select_kernel<
+                T, Operation
+            >();
+
+            kernel(a, b, out, n, operation);
+        } else {
+            run_scalar(a, b, out, n, operation);
+        }
+    }
+
+    // out = a + b
+    template<class T>
+    void add(const T* a, const T* b, T* out, std::size_t n) {
+        run(a, b, out, n, Add());
+    }
+
+    // out = a - b
+    template<class T>
+    void subtract(const T* a, const T* b, T* out, std::size_t n) {
+        run(a, b, out, n, Subtract());
+    }
+
+    // out = a * factor
+    template<class T>
+    void scale(const T* a, T factor, T* out, std::size_t n) {
+        run(a, a, out, n, Scale<T>{factor});
+    }
+
+    // out = a * factor + b
+    template<class T>
+    void multiply_add(const T* a, T factor, const T* b, T* out, std::size_t n) {
+        run(a, b, out, n, MultiplyAdd<T>{factor});
+    }
+}
+
+#endif // KERNELS_H_INCLUDED
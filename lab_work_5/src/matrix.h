@@ -3,19 +3,48 @@
 
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <ostream>
 
+#include "expression.h"
+#include "gemm.h"
+#include "parallel.h"
+#include "text_writer.h"
 #include "utilities.h"
 
 
-template<class T = int, bool Placeholder = true>
-class Matrix {
+// The value of the 'Rows' and 'Columns' parameters of a matrix whose size
+// is only known at run time
+constexpr std::size_t DYNAMIC_SIZE = std::size_t(-1);
+
+// Matrix<T> has its size set at run time and its elements on the heap.
+// Matrix<T, Rows, Columns> (fixed_matrix.h) has both set at compile time.
+template<
+    class T = int,
+    std::size_t Rows = DYNAMIC_SIZE,
+    std::size_t Columns = DYNAMIC_SIZE
+>
+class Matrix;
+
+template<class T>
+class Matrix<T, DYNAMIC_SIZE, DYNAMIC_SIZE>
+    : public MatrixExpression<Matrix<T>>
+{
 public:
     using value_type = T;
     using reference = value_type&;
     using const_reference = const value_type&;
     using size_type = std::size_t;
     using index_type = std::pair<size_type, size_type>;
-    using storage_type = std::vector<std::vector<value_type>>;
+    // The elements are stored row by row in one buffer. Each row takes
+    // 'stride' elements, padded up to a whole number of cache lines where
+    // the element size allows it, so that every row starts on a cache line
+    // boundary. The padding elements are always value_type().
+    using storage_type = std::vector<value_type, AlignedAllocator<value_type>>;
 
     std::integral_constant<size_type, 2> rank;
 
@@ -27,10 +56,10 @@ public:
     size_type size(Dimension dimension) const {
         switch (dimension) {
             case Dimension::ROW:
-                return this->_elements.size();
+                return this->_rows;
             break;
             case Dimension::COLUMN:
-                return this->_elements[0].size();
+                return this->_columns;
             break;
             default:
                 throw std::invalid_argument(
@@ -42,12 +71,48 @@ public:
     void resize(Dimension dimension, size_type value) {
         switch (dimension) {
             case Dimension::ROW:
-                this->_elements.resize(value);
+                this->_elements.resize(value * this->_stride);
+                this->_rows = value;
             break;
-            case Dimension::COLUMN:
-                for (auto& row: this->_elements) {
-                    row.resize(value);
+            case Dimension::COLUMN: {
+                const size_type stride = padded_stride(value);
+
+                if (stride == this->_stride) {
+                    // The rows still fit; cells cut off become padding
+                    for (size_type i = 0; i < this->_rows; ++i) {
+                        auto row = this->_elements.begin() + i * stride;
+                        std::fill(
+                            row + std::min(value, this->_columns),
+                            row + stride,
+                            value_type()
+                        );
+                    }
+                } else {
+                    storage_type elements(this->_rows * stride);
+
+                    parallel_for(
+                        this->_rows,
+                        _row_grain(stride),
+                        this->_execution,
+                        [&](size_type begin, size_type end) {
+                            for (size_type i = begin; i < end; ++i) {
+                                auto row = this->_elements.begin()
+                                    + i * this->_stride;
+                                std::move(
+                                    row,
+                                    row + std::min(value, this->_columns),
+                                    elements.begin() + i * stride
+                                );
+                            }
+                        }
+                    );
+
+                    this->_elements.swap(elements);
+                    this->_stride = stride;
                 }
+
+                this->_columns = value;
+            }
             break;
             default:
                 throw std::invalid_argument(
@@ -62,26 +127,63 @@ public:
         size_type index,
         Compare comp = std::less<const_reference>()
     ) {
+        switch (dimension) {
+            case Dimension::ROW: {
+                auto row = this->_elements.begin() + index * this->_stride;
+                std::sort(row, row + this->_columns, comp);
+            }
+            break;
+            case Dimension::COLUMN:
+                this->_sort_columns(index, index + 1, comp);
+            break;
+            default:
+                throw std::invalid_argument(
+                    "An invalid value was passed for parameter 'dimension'"
+                );
+        }
+    }
+    
+    // Sorts every row, or every column, independently of the others
+    template<class Compare = std::less<const_reference>>
+    void sort_all(
+        Dimension dimension, Compare comp = std::less<const_reference>()
+    ) {
+        this->sort_all(dimension, comp, this->_execution);
+    }
+
+    template<class Compare>
+    void sort_all(Dimension dimension, Compare comp, Execution execution) {
         switch (dimension) {
             case Dimension::ROW:
-                std::sort(
-                    this->_elements[index].begin(),
-                    this->_elements[index].end(),
-                    comp
+                parallel_for(
+                    this->_rows,
+                    _row_grain(this->_columns),
+                    execution,
+                    [&](size_type begin, size_type end) {
+                        for (size_type i = begin; i < end; ++i) {
+                            auto row = this->_elements.begin()
+                                + i * this->_stride;
+                            std::sort(row, row + this->_columns, comp);
+                        }
+                    }
                 );
             break;
             case Dimension::COLUMN: {
-                std::vector<value_type> tmp(this->_elements.size());
-
-                for (size_type i = 0; i < this->_elements.size(); ++i) {
-                    tmp[i] = this->_elements[i][index];
-                }
-
-                std::sort(tmp.begin(), tmp.end(), comp);
+                // Bands of columns one cache line wide
+                const size_type band = _line_elements();
 
-                for (size_type i = 0; i < this->_elements.size(); ++i) {
-                    this->_elements[i][index] = tmp[i];
-                }
+                parallel_for(
+                    (this->_columns + band - 1) / band,
+                    _row_grain(this->_rows * band),
+                    execution,
+                    [&](size_type begin, size_type end) {
+                        this->_sort_columns(
+                            begin * band,
+                            std::min(end * band, this->_columns),
+                            comp
+                        );
+                    }
+                );
             }
             break;
             default:
@@ -90,107 +192,700 @@ public:
                 );
         }
     }
-    
+
+    // The transpose, built tile by tile so that both the rows read and the
+    // rows written stay in cache
+    Matrix transposed() const {
+        Matrix result(this->_columns, this->_rows);
+        const size_type tile = _line_elements() * 2;
+
+        parallel_for(
+            (this->_columns + tile - 1) / tile,
+            _row_grain(this->_rows * tile),
+            this->_execution,
+            [&](size_type begin, size_type end) {
+                const size_type last = std::min(end * tile, this->_columns);
+
+                for (size_type j = begin * tile; j < last; j += tile) {
+                    const size_type width = std::min(tile, last - j);
+                    for (size_type i = 0; i < this->_rows; i += tile) {
+                        const size_type height = std::min(
+                            tile, this->_rows - i
+                        );
+
+                        for (size_type l = 0; l < width; ++l) {
+                            const value_type* from = this->_elements.data()
+                                + i * this->_stride + j + l;
+                            value_type* to = result._elements.data()
+                                + (j + l) * result._stride + i;
+                            for (size_type k = 0; k < height; ++k) {
+                                to[k] = from[k * this->_stride];
+                            }
+                        }
+                    }
+                }
+            }
+        );
+
+        return result;
+    }
+
+    // Combines all elements with 'init' in no particular order or grouping,
+    // like std::reduce(), so 'operation' should be associative and
+    // commutative
+    template<class BinaryOperation = std::plus<value_type>>
+    value_type reduce(
+        value_type init = value_type(),
+        BinaryOperation operation = std::plus<value_type>()
+    ) const {
+        return this->reduce(init, operation, this->_execution);
+    }
+
+    template<class BinaryOperation>
+    value_type reduce(
+        value_type init, BinaryOperation operation, Execution execution
+    ) const {
+        std::mutex m;
+
+        parallel_for(
+            this->_rows,
+            _row_grain(this->_columns),
+            execution,
+            [&](size_type begin, size_type end) {
+                if (this->_columns == 0) {
+                    return;
+                }
+
+                auto row = this->_elements.begin() + begin * this->_stride;
+                value_type result = std::accumulate(
+                    row + 1, row + this->_columns, row[0], operation
+                );
+                for (size_type i = begin + 1; i < end; ++i) {
+                    row = this->_elements.begin() + i * this->_stride;
+                    result = std::accumulate(
+                        row, row + this->_columns, std::move(result), operation
+                    );
+                }
+
+                std::lock_guard<std::mutex> lock(m);
+                init = operation(init, result);
+            }
+        );
+
+        return init;
+    }
+
+    // How the operations that the matrix performs or is assigned the result
+    // of are run when no Execution is passed. Execution::AUTOMATIC at first.
+    Execution execution() const {
+        return this->_execution;
+    }
+
+    void set_execution(Execution execution) {
+        this->_execution = execution;
+    }
+
     reference operator[](index_type index) {
-        return this->_elements[index.first][index.second];
+        return this->_elements[index.first * this->_stride + index.second];
     }
 
     const_reference operator[](index_type index) const {
-        return this->_elements[index.first][index.second];
+        return this->_elements[index.first * this->_stride + index.second];
+    }
+
+    // The interface of a MatrixExpression
+    size_type rows() const {
+        return this->_rows;
+    }
+
+    size_type columns() const {
+        return this->_columns;
+    }
+
+    const_reference operator()(size_type row, size_type column) const {
+        return this->_elements[row * this->_stride + column];
+    }
+
+    const value_type* block(size_type offset, size_type, value_type*) const {
+        return this->_elements.data() + offset;
+    }
+
+    // The storage, row by row, with stride() elements per row
+    value_type* data() {
+        return this->_elements.data();
+    }
+
+    const value_type* data() const {
+        return this->_elements.data();
     }
 
-    Matrix operator+(const Matrix& other) const {
-        return _perform_mathematical_operation_with_matrix(
-            other, sum<value_type>
+    size_type stride() const {
+        return this->_stride;
+    }
+
+    // The number of elements a row of 'columns' elements takes in storage
+    static size_type padded_stride(size_type columns) {
+        if (
+            sizeof(value_type) > CACHE_LINE_SIZE
+            ||
+            CACHE_LINE_SIZE % sizeof(value_type) != 0
+        ) {
+            return columns;
+        }
+
+        const size_type per_line = CACHE_LINE_SIZE / sizeof(value_type);
+
+        return (columns + per_line - 1) / per_line * per_line;
+    }
+
+    // The sum and the difference are expressions that are only computed
+    // when assigned to a Matrix
+    using MatrixExpression<Matrix>::operator+;
+    using MatrixExpression<Matrix>::operator-;
+
+    MatrixBinaryExpression<Matrix, Sum, Matrix> operator+(
+        const Matrix& other
+    ) const & {
+        return MatrixBinaryExpression<Matrix, Sum, Matrix>(*this, other);
+    }
+
+    MatrixBinaryExpression<Matrix, Difference, Matrix> operator-(
+        const Matrix& other
+    ) const & {
+        return MatrixBinaryExpression<Matrix, Difference, Matrix>(
+            *this, other
         );
     }
 
-    Matrix operator-(const Matrix& other) const {
-        return _perform_mathematical_operation_with_matrix(
-            other, difference<value_type>
+    // When an operand is a temporary, the result is computed in its storage
+    // and the storage is moved out, so nothing is allocated
+    Matrix operator+(const Matrix& other) && {
+        *this += other;
+
+        return std::move(*this);
+    }
+
+    Matrix operator+(Matrix&& other) const & {
+        other.assign(*this + other, other._execution);
+
+        return std::move(other);
+    }
+
+    Matrix operator+(Matrix&& other) && {
+        return std::move(*this) + other;
+    }
+
+    Matrix operator-(const Matrix& other) && {
+        *this -= other;
+
+        return std::move(*this);
+    }
+
+    Matrix operator-(Matrix&& other) const & {
+        other.assign(*this - other, other._execution);
+
+        return std::move(other);
+    }
+
+    Matrix operator-(Matrix&& other) && {
+        return std::move(*this) - other;
+    }
+
+    // Elementwise, in place. The operands must have the size of the matrix.
+    template<class E>
+    Matrix& operator+=(const MatrixExpression<E>& expression) {
+        return *this = *this + expression.self();
+    }
+
+    template<class E>
+    Matrix& operator-=(const MatrixExpression<E>& expression) {
+        return *this = *this - expression.self();
+    }
+
+    // Unlike the sum and the difference, the product is computed right away
+    using MatrixExpression<Matrix>::operator*;
+
+    Matrix operator*(const Matrix& other) const {
+        Matrix result(this->_rows, other._columns);
+        gemm(
+            value_type(1),
+            *this,
+            other,
+            value_type(),
+            result,
+            this->_execution
         );
+
+        return result;
+    }
+
+    template<class E>
+    Matrix& operator=(const MatrixExpression<E>& expression) {
+        this->_assign(expression.self(), this->_execution);
+
+        return *this;
+    }
+
+    Matrix& operator=(const Matrix& other) = default;
+
+    // The source is left empty, 0 x 0, so that it is still consistent with
+    // its storage and can be assigned to again
+    Matrix& operator=(Matrix&& other) noexcept {
+        if (this != &other) {
+            this->_elements = std::move(other._elements);
+            this->_rows = other._rows;
+            this->_columns = other._columns;
+            this->_stride = other._stride;
+            this->_execution = other._execution;
+            other._reset();
+        }
+
+        return *this;
+    }
+
+    // The same as '*this = expression', run the given way
+    template<class E>
+    Matrix& assign(const MatrixExpression<E>& expression, Execution execution) {
+        this->_assign(expression.self(), execution);
+
+        return *this;
     }
 
     Matrix()
     :
-        _elements()
+        _elements(),
+        _rows(0),
+        _columns(0),
+        _stride(0),
+        _execution(Execution::AUTOMATIC)
     {}
 
-    Matrix(std::initializer_list<std::vector<value_type>> init)
+    Matrix(const Matrix& other) = default;
+
+    Matrix(Matrix&& other) noexcept
     :
-        _elements(init)
+        _elements(std::move(other._elements)),
+        _rows(other._rows),
+        _columns(other._columns),
+        _stride(other._stride),
+        _execution(other._execution)
+    {
+        other._reset();
+    }
+
+    // A matrix of value_type()
+    Matrix(size_type rows, size_type columns)
+    :
+        _elements(rows * padded_stride(columns)),
+        _rows(rows),
+        _columns(columns),
+        _stride(padded_stride(columns)),
+        _execution(Execution::AUTOMATIC)
     {}
 
-    template<class U>
-    friend void print_matrix(
-        std::ostream& out, const Matrix<U>& matrix, std::string delimiter
-    );
+    // Rows shorter than the longest one are padded with value_type()
+    Matrix(std::initializer_list<std::vector<value_type>> init)
+    :
+        _elements(),
+        _rows(init.size()),
+        _columns(0),
+        _stride(0),
+        _execution(Execution::AUTOMATIC)
+    {
+        for (const auto& row: init) {
+            this->_columns = std::max(this->_columns, row.size());
+        }
+        this->_stride = padded_stride(this->_columns);
+        this->_elements.resize(this->_rows * this->_stride);
+
+        auto row = this->_elements.begin();
+        for (const auto& init_row: init) {
+            std::copy(init_row.begin(), init_row.end(), row);
+            row += this->_stride;
+        }
+    }
+
+    template<class E>
+    Matrix(const MatrixExpression<E>& expression)
+    :
+        _elements(),
+        _rows(0),
+        _columns(0),
+        _stride(0),
+        _execution(Execution::AUTOMATIC)
+    {
+        this->_assign(expression.self(), this->_execution);
+    }
 
 private:
-    template<class U>
-    Matrix _perform_mathematical_operation_with_matrix(
-        const Matrix& other,
-        value_type operation(const U& a, const U& b)
-    ) const {
-        if (
-            this->_elements.size() != other._elements.size()
-            ||
-            this->_elements[0].size() != other._elements[0].size()
-        ) {
-            throw std::length_error("Matrix sizes do not match");
+    void _reset() noexcept {
+        this->_elements.clear();
+        this->_rows = 0;
+        this->_columns = 0;
+        this->_stride = 0;
+    }
+
+    // Evaluates 'expression' in one pass. The storage is only replaced if
+    // the size differs, in which case the matrix cannot be an operand of
+    // the expression; otherwise every element is read and written in
+    // place, which is fine for elementwise expressions like 'a = a + b'.
+    template<class E>
+    void _assign(const E& expression, Execution execution) {
+        const size_type rows = expression.rows();
+        const size_type columns = expression.columns();
+
+        if (rows != this->_rows || columns != this->_columns) {
+            Matrix result(rows, columns);
+            result._evaluate(expression, execution);
+
+            this->_elements.swap(result._elements);
+            this->_rows = rows;
+            this->_columns = columns;
+            this->_stride = result._stride;
+
+            return;
+        }
+
+        this->_evaluate(expression, execution);
+    }
+
+    // Evaluates bands of rows in parallel
+    template<class E>
+    void _evaluate(const E& expression, Execution execution) {
+        parallel_for(
+            this->_rows,
+            _row_grain(this->_stride),
+            execution,
+            [&](size_type begin, size_type end) {
+                this->_evaluate_rows(expression, begin, end);
+            }
+        );
+    }
+
+    template<class E>
+    void _evaluate_rows(const E& expression, size_type begin, size_type end) {
+        if constexpr (kernels::is_vectorized<value_type>::value) {
+            // All operands have this stride too, so the rows are evaluated
+            // as one run, padding and all. resize() clears any padding it
+            // turns into elements.
+            value_type* data = this->_elements.data();
+            const size_type last = end * this->_stride;
+
+            for (
+                size_type i = begin * this->_stride;
+                i < last;
+                i += MATRIX_BLOCK_SIZE
+            ) {
+                const size_type n = std::min(MATRIX_BLOCK_SIZE, last - i);
+                const value_type* block = expression.block(i, n, data + i);
+                if (block != data + i) {
+                    std::copy(block, block + n, data + i);
+                }
+            }
+        } else {
+            for (size_type i = begin; i < end; ++i) {
+                const size_type row = i * this->_stride;
+                for (size_type j = 0; j < this->_columns; ++j) {
+                    this->_elements[row + j] = expression(i, j);
+                }
+            }
         }
+    }
+
+    // Sorts the columns [begin, end) by copying them into contiguous runs,
+    // a row at a time, sorting the runs and copying them back. With up to a
+    // cache line of columns, each row copied is a single line.
+    template<class Compare>
+    void _sort_columns(size_type begin, size_type end, Compare comp) {
+        const size_type rows = this->_rows;
+        std::vector<value_type>& columns = _scratch(
+            rows * std::min(_line_elements(), end - begin)
+        );
+
+        for (size_type j = begin; j < end; j += _line_elements()) {
+            const size_type width = std::min(_line_elements(), end - j);
+
+            for (size_type i = 0; i < rows; ++i) {
+                auto row = this->_elements.begin() + i * this->_stride + j;
+                for (size_type k = 0; k < width; ++k) {
+                    columns[k * rows + i] = std::move(row[k]);
+                }
+            }
 
-        Matrix result;
-        result._elements.resize(this->_elements.size());
-        
-        for (size_type i = 0; i < this->_elements.size(); ++i) {
-            result._elements[i].resize(this->_elements[i].size());
-            for (size_type j = 0; j < this->_elements[0].size(); ++j) {
-                result._elements[i][j] = operation(
-                    this->_elements[i][j], other._elements[i][j]
+            for (size_type k = 0; k < width; ++k) {
+                std::sort(
+                    columns.begin() + k * rows,
+                    columns.begin() + (k + 1) * rows,
+                    comp
                 );
             }
+
+            for (size_type i = 0; i < rows; ++i) {
+                auto row = this->_elements.begin() + i * this->_stride + j;
+                for (size_type k = 0; k < width; ++k) {
+                    row[k] = std::move(columns[k * rows + i]);
+                }
+            }
         }
+    }
 
-        return result;
+    // A buffer of at least 'size' elements for the calling thread. It is
+    // kept between calls, so that repeated column sorts do not allocate.
+    static std::vector<value_type>& _scratch(size_type size) {
+        static thread_local std::vector<value_type> buffer;
+        if (buffer.size() < size) {
+            buffer.resize(size);
+        }
+
+        return buffer;
+    }
+
+    // The number of elements in a cache line, or 1 if they are bigger
+    static constexpr size_type _line_elements() {
+        return std::max(CACHE_LINE_SIZE / sizeof(value_type), size_type(1));
+    }
+
+    // The number of rows of 'elements' elements each that is worth a thread
+    static size_type _row_grain(size_type elements) {
+        return PARALLEL_GRAIN_SIZE / std::max(elements, size_type(1)) + 1;
     }
 
     storage_type _elements;
+    size_type _rows;
+    size_type _columns;
+    size_type _stride;
+    Execution _execution;
 };
 
-template<class U>
+// Numbers are formatted the way the stream would format them, but into a
+// TextWriter, and rows end with '\n' rather than std::endl, so the stream
+// gets big blocks and is not flushed. A stream set to hexadecimal, shown
+// signs and the like formats the numbers itself.
+template<class U, std::size_t Rows, std::size_t Columns>
 void print_matrix(
-    std::ostream& out, const Matrix<U>& matrix, std::string delimiter
+    std::ostream& out,
+    const Matrix<U, Rows, Columns>& matrix,
+    std::string delimiter
 ) {
-    for (const auto& row: matrix._elements) {
-        for (std::size_t i = 0; i < row.size(); ++i) {
-            out << row[i];
-            if (i < row.size() - 1) {
+    if constexpr (is_text_number<U>::value) {
+        if (is_plain_format(out)) {
+            TextWriter writer(out);
+
+            for (std::size_t i = 0; i < matrix.rows(); ++i) {
+                for (std::size_t j = 0; j < matrix.columns(); ++j) {
+                    if constexpr (std::is_floating_point<U>::value) {
+                        writer.write_number(
+                            matrix(i, j), float_format(out), out.precision()
+                        );
+                    } else {
+                        writer.write_number(matrix(i, j));
+                    }
+                    if (j < matrix.columns() - 1) {
+                        writer.write(delimiter);
+                    }
+                }
+                writer.write('\n');
+            }
+
+            return;
+        }
+    }
+
+    for (std::size_t i = 0; i < matrix.rows(); ++i) {
+        for (std::size_t j = 0; j < matrix.columns(); ++j) {
+            out << matrix(i, j);
+            if (j < matrix.columns() - 1) {
                 out << delimiter;
             }
         }
-        out << std::endl;
+        out << '\n';
     }
 }
 
-template<class U, std::enable_if_t<!std::is_integral<U>::value, bool> = true>
-std::ostream& operator<<(std::ostream& out, const Matrix<U>& matrix) {
+// c = alpha * a * b + beta * c
+template<class T>
+void gemm(
+    T alpha,
+    const Matrix<T>& a,
+    const Matrix<T>& b,
+    T beta,
+    Matrix<T>& c,
+    Execution execution
+) {
+    if (
+        a.columns() != b.rows()
+        ||
+        c.rows() != a.rows()
+        ||
+        c.columns() != b.columns()
+    ) {
+        throw std::length_error("Matrix sizes do not match");
+    }
+
+    if (&c == &a || &c == &b) {
+        Matrix<T> result(c);
+        gemm(alpha, a, b, beta, result, execution);
+        c = std::move(result);
+
+        return;
+    }
+
+    kernels::gemm(
+        a.rows(),
+        b.columns(),
+        a.columns(),
+        alpha,
+        a.data(),
+        a.stride(),
+        b.data(),
+        b.stride(),
+        beta,
+        c.data(),
+        c.stride(),
+        execution
+    );
+}
+
+// The same, run the way 'c' is set to
+template<class T>
+void gemm(
+    T alpha,
+    const Matrix<T>& a,
+    const Matrix<T>& b,
+    T beta,
+    Matrix<T>& c
+) {
+    gemm(alpha, a, b, beta, c, c.execution());
+}
+
+// Matrices are referred to from expressions, since they are not copied cheaply
+template<class T>
+struct MatrixOperand<Matrix<T>> {
+    using type = const Matrix<T>&;
+};
+
+// So an expression with a temporary Matrix in it would outlive the matrix
+// if it were kept, as in 'auto e = x * 2 + Matrix<T>(...)'. Instead, the
+// result is computed right away in the temporary's storage, the way the
+// Matrix operators with a temporary operand do.
+template<class T, class E>
+Matrix<T> operator+(Matrix<T>&& matrix, const MatrixExpression<E>& expression) {
+    matrix += expression;
+
+    return std::move(matrix);
+}
+
+template<class E, class T>
+Matrix<T> operator+(const MatrixExpression<E>& expression, Matrix<T>&& matrix) {
+    matrix.assign(expression.self() + matrix, matrix.execution());
+
+    return std::move(matrix);
+}
+
+template<class T, class E>
+Matrix<T> operator-(Matrix<T>&& matrix, const MatrixExpression<E>& expression) {
+    matrix -= expression;
+
+    return std::move(matrix);
+}
+
+template<class E, class T>
+Matrix<T> operator-(const MatrixExpression<E>& expression, Matrix<T>&& matrix) {
+    matrix.assign(expression.self() - matrix, matrix.execution());
+
+    return std::move(matrix);
+}
+
+template<
+    class T,
+    class U,
+    std::enable_if_t<std::is_arithmetic<U>::value, bool> = true
+>
+Matrix<T> operator*(Matrix<T>&& matrix, const U& factor) {
+    matrix = matrix * factor;
+
+    return std::move(matrix);
+}
+
+template<
+    class U,
+    class T,
+    std::enable_if_t<std::is_arithmetic<U>::value, bool> = true
+>
+Matrix<T> operator*(const U& factor, Matrix<T>&& matrix) {
+    return std::move(matrix) * factor;
+}
+
+template<
+    class U,
+    std::size_t Rows,
+    std::size_t Columns,
+    std::enable_if_t<!std::is_integral<U>::value, bool> = true
+>
+std::ostream& operator<<(
+    std::ostream& out, const Matrix<U, Rows, Columns>& matrix
+) {
     print_matrix(out, matrix, " | ");
 
     return out;
 }
 
-template<class U, std::enable_if_t<std::is_integral<U>::value, bool> = true>
-std::ostream& operator<<(std::ostream& out, const Matrix<U>& matrix) {
+template<
+    class U,
+    std::size_t Rows,
+    std::size_t Columns,
+    std::enable_if_t<std::is_integral<U>::value, bool> = true
+>
+std::ostream& operator<<(
+    std::ostream& out, const Matrix<U, Rows, Columns>& matrix
+) {
     print_matrix(out, matrix, "; ");
 
     return out;
 }
 
+// An expression is printed the same way as the matrix it evaluates to
+template<class E, class Operation, class F>
+std::ostream& operator<<(
+    std::ostream& out, const MatrixBinaryExpression<E, Operation, F>& expression
+) {
+    return out << Matrix<typename E::value_type>(expression);
+}
+
+template<class E>
+std::ostream& operator<<(
+    std::ostream& out, const MatrixScaledExpression<E>& expression
+) {
+    return out << Matrix<typename E::value_type>(expression);
+}
+
 // Explicit specialization
+template<>
+MatrixBinaryExpression<Matrix<std::string>, Difference, Matrix<std::string>>
+Matrix<std::string>::operator-(
+    const Matrix<std::string>& other
+) const & = delete;
+
+template<>
+Matrix<std::string> Matrix<std::string>::operator-(
+    const Matrix<std::string>& other
+) && = delete;
+
+template<>
+Matrix<std::string> Matrix<std::string>::operator-(
+    Matrix<std::string>&& other
+) const & = delete;
+
 template<>
 Matrix<std::string> Matrix<std::string>::operator-(
+    Matrix<std::string>&& other
+) && = delete;
+
+template<>
+Matrix<std::string> Matrix<std::string>::operator*(
     const Matrix<std::string>& other
 ) const = delete;
 
+#include "fixed_matrix.h"
+
 #endif // MATRIX_H_INCLUDED
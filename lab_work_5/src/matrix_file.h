@@ -0,0 +1,312 @@
+#ifndef MATRIX_FILE_H_INCLUDED
+#define MATRIX_FILE_H_INCLUDED
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "expression.h"
+#include "matrix.h"
+
+
+// A binary file format for matrices of arithmetic types. The file is a
+// fixed header followed, at a multiple of 64 bytes, by the storage of the
+// matrix exactly as it is in memory: row by row, 'stride' elements per row.
+// Loading it therefore needs no parsing: load_matrix() maps the file and
+// hands out a read-only view of the mapping, and pages are only read from
+// disk as the elements are used.
+
+// The type of the elements, as stored in the header
+enum class MatrixElementType : std::uint32_t {
+    INT8 = 1,
+    UINT8,
+    INT16,
+    UINT16,
+    INT32,
+    UINT32,
+    INT64,
+    UINT64,
+    FLOAT32,
+    FLOAT64
+};
+
+template<class T>
+constexpr MatrixElementType matrix_element_type() {
+    static_assert(
+        std::is_arithmetic<T>::value && !std::is_same<T, bool>::value,
+        "Only matrices of numbers can be saved"
+    );
+
+    if constexpr (std::is_floating_point<T>::value) {
+        static_assert(
+            sizeof(T) == 4 || sizeof(T) == 8,
+            "Only 32- and 64-bit floating point numbers can be saved"
+        );
+
+        return sizeof(T) == 4
+            ? MatrixElementType::FLOAT32
+            : MatrixElementType::FLOAT64;
+    } else {
+        const bool is_signed = std::is_signed<T>::value;
+        switch (sizeof(T)) {
+            case 1:
+                return is_signed
+                    ? MatrixElementType::INT8
+                    : MatrixElementType::UINT8;
+            case 2:
+                return is_signed
+                    ? MatrixElementType::INT16
+                    : MatrixElementType::UINT16;
+            case 4:
+                return is_signed
+                    ? MatrixElementType::INT32
+                    : MatrixElementType::UINT32;
+            default:
+                return is_signed
+                    ? MatrixElementType::INT64
+                    : MatrixElementType::UINT64;
+        }
+    }
+}
+
+struct MatrixFileHeader {
+    char magic[8];
+    std::uint32_t version;
+    // BYTE_ORDER_MARK as written by the machine that saved the file
+    std::uint32_t byte_order;
+    MatrixElementType element_type;
+    std::uint32_t element_size;
+    std::uint64_t rows;
+    std::uint64_t columns;
+    // Elements per row in the payload, padding included
+    std::uint64_t stride;
+    // Where the payload starts, from the start of the file
+    std::uint64_t payload_offset;
+
+    static constexpr char MAGIC[8] = {'L', '5', 'M', 'A', 'T', 'R', 'I', 'X'};
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static constexpr std::uint64_t PAYLOAD_ALIGNMENT = CACHE_LINE_SIZE;
+};
+
+// A read-only matrix over a mapped file. Copies share the mapping, which
+// is unmapped with the last of them. It can be an operand of matrix
+// expressions, and converted to a Matrix, which copies it.
+template<class T>
+class MatrixView : public MatrixExpression<MatrixView<T>> {
+public:
+    using value_type = T;
+    using const_reference = const value_type&;
+    using size_type = std::size_t;
+    using index_type = std::pair<size_type, size_type>;
+
+    size_type rows() const {
+        return this->_rows;
+    }
+
+    size_type columns() const {
+        return this->_columns;
+    }
+
+    size_type stride() const {
+        return this->_stride;
+    }
+
+    const value_type* data() const {
+        return this->_data;
+    }
+
+    const_reference operator[](index_type index) const {
+        return this->_data[index.first * this->_stride + index.second];
+    }
+
+    const_reference operator()(size_type row, size_type column) const {
+        return this->_data[row * this->_stride + column];
+    }
+
+    const value_type* block(size_type offset, size_type, value_type*) const {
+        return this->_data + offset;
+    }
+
+    MatrixView(
+        std::shared_ptr<const void> mapping,
+        const value_type* data,
+        size_type rows,
+        size_type columns,
+        size_type stride
+    )
+    :
+        _mapping(std::move(mapping)),
+        _data(data),
+        _rows(rows),
+        _columns(columns),
+        _stride(stride)
+    {}
+
+private:
+    std::shared_ptr<const void> _mapping;
+    const value_type* _data;
+    size_type _rows;
+    size_type _columns;
+    size_type _stride;
+};
+
+template<class T>
+void save_matrix(const std::string& filename, const Matrix<T>& matrix) {
+    MatrixFileHeader header = {};
+    std::memcpy(header.magic, MatrixFileHeader::MAGIC, sizeof(header.magic));
+    header.version = MatrixFileHeader::VERSION;
+    header.byte_order = MatrixFileHeader::BYTE_ORDER_MARK;
+    header.element_type = matrix_element_type<T>();
+    header.element_size = sizeof(T);
+    header.rows = matrix.rows();
+    header.columns = matrix.columns();
+    header.stride = matrix.stride();
+    header.payload_offset = (sizeof(header)
+        + MatrixFileHeader::PAYLOAD_ALIGNMENT - 1)
+        / MatrixFileHeader::PAYLOAD_ALIGNMENT
+        * MatrixFileHeader::PAYLOAD_ALIGNMENT;
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::system_error(
+            errno, std::generic_category(), "Cannot open " + filename
+        );
+    }
+
+    const char padding[MatrixFileHeader::PAYLOAD_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(padding, header.payload_offset - sizeof(header));
+    out.write(
+        reinterpret_cast<const char*>(matrix.data()),
+        matrix.rows() * matrix.stride() * sizeof(T)
+    );
+
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Cannot write " + filename);
+    }
+}
+
+// Maps a file written by save_matrix(). Throws std::runtime_error if the
+// file is not one, holds elements of another type, or was written on a
+// machine with another byte order.
+template<class T>
+MatrixView<T> load_matrix(const std::string& filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(
+            errno, std::generic_category(), "Cannot open " + filename
+        );
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(
+            error, std::generic_category(), "Cannot stat " + filename
+        );
+    }
+    const std::uint64_t size = status.st_size;
+
+    MatrixFileHeader header;
+    if (
+        size < sizeof(header)
+        || ::pread(fd, &header, sizeof(header), 0) != sizeof(header)
+    ) {
+        ::close(fd);
+        throw std::runtime_error(filename + " is not a matrix file");
+    }
+
+    const auto fail = [&](const std::string& reason) {
+        ::close(fd);
+        throw std::runtime_error(filename + ": " + reason);
+    };
+
+    if (
+        std::memcmp(header.magic, MatrixFileHeader::MAGIC, sizeof(header.magic))
+        != 0
+    ) {
+        fail("not a matrix file");
+    }
+    if (header.version != MatrixFileHeader::VERSION) {
+        fail("unsupported version " + std::to_string(header.version));
+    }
+    if (header.byte_order != MatrixFileHeader::BYTE_ORDER_MARK) {
+        fail("written on a machine with another byte order");
+    }
+    if (
+        header.element_type != matrix_element_type<T>()
+        || header.element_size != sizeof(T)
+    ) {
+        fail("holds elements of another type");
+    }
+    // Expressions walk the storage of all operands in step, so the rows
+    // must be laid out as a Matrix<T> would lay them out
+    if (
+        header.columns > SIZE_MAX / sizeof(T)
+        || header.stride != Matrix<T>::padded_stride(header.columns)
+        || header.payload_offset % MatrixFileHeader::PAYLOAD_ALIGNMENT != 0
+    ) {
+        fail("unsupported layout");
+    }
+    if (
+        header.payload_offset > size
+        || (
+            header.stride != 0
+            && header.rows > (size - header.payload_offset) / sizeof(T)
+                / header.stride
+        )
+    ) {
+        fail("truncated");
+    }
+
+    // An empty matrix maps nothing
+    if (header.rows * header.stride == 0) {
+        ::close(fd);
+
+        return MatrixView<T>(
+            nullptr, nullptr, header.rows, header.columns, header.stride
+        );
+    }
+
+    void* address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::system_error(
+            error, std::generic_category(), "Cannot map " + filename
+        );
+    }
+
+    std::shared_ptr<const void> mapping(address, [size](const void* p) {
+        ::munmap(const_cast<void*>(p), size);
+    });
+    const T* data = reinterpret_cast<const T*>(
+        static_cast<const char*>(address) + header.payload_offset
+    );
+
+    return MatrixView<T>(
+        std::move(mapping), data, header.rows, header.columns, header.stride
+    );
+}
+
+template<class T>
+std::ostream& operator<<(std::ostream& out, const MatrixView<T>& view) {
+    return out << Matrix<T>(view);
+}
+
+#endif // MATRIX_FILE_H_INCLUDED
@@ -0,0 +1,226 @@
+#ifndef MATRIX_TEXT_H_INCLUDED
+#define MATRIX_TEXT_H_INCLUDED
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "matrix.h"
+#include "parallel.h"
+#include "text_writer.h"
+
+
+// Reading and writing matrices of numbers as delimited text: one row per
+// line, elements separated by "; " or " | " (as operator<< prints them) or
+// by commas (CSV).
+
+// Text is parsed in pieces of about this many bytes, in parallel
+constexpr std::size_t MATRIX_TEXT_PIECE_SIZE = std::size_t(1) << 20;
+
+// Writes the rows of 'matrix' separated by '\n', and its elements by
+// 'delimiter'. Floating point numbers are written in the shortest form that
+// parse_matrix() reads back as the same number.
+template<class T, std::size_t Rows, std::size_t Columns>
+void write_matrix(
+    std::ostream& out,
+    const Matrix<T, Rows, Columns>& matrix,
+    std::string_view delimiter = "; "
+) {
+    static_assert(
+        is_text_number<T>::value, "Only matrices of numbers can be written"
+    );
+
+    TextWriter writer(out);
+    for (std::size_t i = 0; i < matrix.rows(); ++i) {
+        for (std::size_t j = 0; j < matrix.columns(); ++j) {
+            writer.write_number(matrix(i, j));
+            if (j < matrix.columns() - 1) {
+                writer.write(delimiter);
+            }
+        }
+        writer.write('\n');
+    }
+}
+
+// The elements and row lengths of a piece of text
+template<class T>
+struct ParsedMatrixText {
+    std::vector<T> values;
+    std::vector<std::size_t> lengths;
+};
+
+// Parses whole lines. Blank lines are skipped.
+template<class T>
+void parse_matrix_lines(std::string_view text, ParsedMatrixText<T>& parsed) {
+    const auto is_space = [](char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    };
+
+    const char* p = text.data();
+    const char* const end = text.data() + text.size();
+
+    while (p < end) {
+        const char* line_end = static_cast<const char*>(
+            std::memchr(p, '\n', end - p)
+        );
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+
+        std::size_t length = 0;
+        while (true) {
+            while (p < line_end && is_space(*p)) {
+                ++p;
+            }
+            if (p == line_end && length == 0) {
+                break;
+            }
+
+            // from_chars() does not take a plus sign, and a minus sign must
+            // not follow one
+            const char* first = p;
+            if (p < line_end && *p == '+') {
+                ++first;
+            }
+            const bool two_signs = first != p
+                && first < line_end
+                && *first == '-';
+
+            T value;
+            const std::from_chars_result result = std::from_chars(
+                first, line_end, value
+            );
+            if (
+                two_signs
+                || result.ec != std::errc()
+                || result.ptr == first
+            ) {
+                const char* token_end = std::find_if(
+                    p, line_end, [](char c) {
+                        return c == ';' || c == '|' || c == ',';
+                    }
+                );
+                throw std::invalid_argument(
+                    "Invalid matrix element '" + std::string(p, token_end) + "'"
+                );
+            }
+            parsed.values.push_back(value);
+            ++length;
+
+            p = result.ptr;
+            while (p < line_end && is_space(*p)) {
+                ++p;
+            }
+            if (p == line_end) {
+                break;
+            }
+            if (*p != ';' && *p != '|' && *p != ',') {
+                throw std::invalid_argument(
+                    "Invalid matrix delimiter '" + std::string(1, *p) + "'"
+                );
+            }
+            ++p;
+        }
+
+        if (length > 0) {
+            parsed.lengths.push_back(length);
+        }
+        p = line_end + 1;
+    }
+}
+
+// Parses text in the format write_matrix() and operator<< produce. Rows
+// shorter than the longest one are padded with T(), as with an initializer
+// list. Throws std::invalid_argument at the first thing that is not a
+// number or a delimiter.
+//
+// The text is cut at line ends into pieces that are parsed in parallel,
+// and then copied into the matrix in parallel.
+template<class T>
+Matrix<T> parse_matrix(
+    std::string_view text, Execution execution = Execution::AUTOMATIC
+) {
+    static_assert(
+        is_text_number<T>::value, "Only matrices of numbers can be parsed"
+    );
+
+    std::vector<std::size_t> bounds = {0};
+    const std::size_t pieces = std::max<std::size_t>(
+        text.size() / MATRIX_TEXT_PIECE_SIZE, 1
+    );
+    for (std::size_t k = 1; k < pieces; ++k) {
+        const std::size_t line_end = text.find('\n', k * text.size() / pieces);
+        if (line_end == std::string_view::npos) {
+            break;
+        }
+        if (line_end + 1 > bounds.back()) {
+            bounds.push_back(line_end + 1);
+        }
+    }
+    bounds.push_back(text.size());
+
+    std::vector<ParsedMatrixText<T>> parsed(bounds.size() - 1);
+    parallel_for(
+        parsed.size(),
+        1,
+        execution,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                parse_matrix_lines(
+                    text.substr(bounds[k], bounds[k + 1] - bounds[k]),
+                    parsed[k]
+                );
+            }
+        }
+    );
+
+    std::vector<std::size_t> first_rows = {0};
+    std::size_t columns = 0;
+    for (const auto& piece: parsed) {
+        first_rows.push_back(first_rows.back() + piece.lengths.size());
+        for (std::size_t length: piece.lengths) {
+            columns = std::max(columns, length);
+        }
+    }
+
+    Matrix<T> matrix(first_rows.back(), columns);
+    parallel_for(
+        parsed.size(),
+        1,
+        execution,
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t k = begin; k < end; ++k) {
+                const T* value = parsed[k].values.data();
+                T* row = matrix.data() + first_rows[k] * matrix.stride();
+                for (std::size_t length: parsed[k].lengths) {
+                    std::copy(value, value + length, row);
+                    value += length;
+                    row += matrix.stride();
+                }
+            }
+        }
+    );
+
+    return matrix;
+}
+
+// Reads the rest of 'in' and parses it
+template<class T>
+Matrix<T> read_matrix(
+    std::istream& in, Execution execution = Execution::AUTOMATIC
+) {
+    std::ostringstream text;
+    text << in.rdbuf();
+
+    return parse_matrix<T>(text.str(), execution);
+}
+
+#endif // MATRIX_TEXT_H_INCLUDED
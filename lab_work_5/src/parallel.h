@@ -0,0 +1,204 @@
+#ifndef PARALLEL_H_INCLUDED
+#define PARALLEL_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// How an operation on a matrix is run
+enum class Execution {
+    // In parallel if there is enough work to make up for handing it out
+    AUTOMATIC,
+    // On the calling thread
+    SEQUENTIAL,
+    // In parallel whatever the size
+    PARALLEL
+};
+
+// The least number of elements that is worth a thread for elementwise work
+constexpr std::size_t PARALLEL_GRAIN_SIZE = std::size_t(1) << 16;
+
+// A fixed set of worker threads that run submitted tasks in order. The
+// shared pool has one worker per core but one, since the thread that hands
+// out work takes part in it too.
+class ThreadPool {
+public:
+    static ThreadPool& shared() {
+        static ThreadPool pool(
+            std::max(std::thread::hardware_concurrency(), 1u) - 1
+        );
+
+        return pool;
+    }
+
+    // The number of threads that work on a parallel_for(), the calling one
+    // included
+    std::size_t concurrency() const {
+        return this->_workers.size() + 1;
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(this->_m);
+            this->_tasks.push_back(std::move(task));
+        }
+        this->_cv.notify_one();
+    }
+
+    explicit ThreadPool(std::size_t workers)
+    :
+        _stopping(false)
+    {
+        for (std::size_t i = 0; i < workers; ++i) {
+            this->_workers.emplace_back(&ThreadPool::_work, this);
+        }
+    }
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->_m);
+            this->_stopping = true;
+        }
+        this->_cv.notify_all();
+
+        for (auto& worker: this->_workers) {
+            worker.join();
+        }
+    }
+
+private:
+    void _work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(this->_m);
+                this->_cv.wait(lock, [this]() {
+                    return this->_stopping || !this->_tasks.empty();
+                });
+                if (this->_tasks.empty()) {
+                    return;
+                }
+                task = std::move(this->_tasks.front());
+                this->_tasks.pop_front();
+            }
+
+            task();
+        }
+    }
+
+    std::mutex _m;
+    std::condition_variable _cv;
+    std::deque<std::function<void()>> _tasks;
+    std::vector<std::thread> _workers;
+    bool _stopping;
+};
+
+// Calls body(begin, end) for consecutive ranges that cover [0, count),
+// spread over the threads of the shared pool, and returns once they are
+// all done. With Execution::AUTOMATIC, ranges are at least 'grain' long,
+// so that less than two grains of work stays on the calling thread.
+//
+// The calling thread takes ranges as well and only waits for the ones
+// other threads have started, so parallel_for() may be called from inside
+// another one. The first exception thrown by 'body' is rethrown.
+template<class Body>
+void parallel_for(
+    std::size_t count, std::size_t grain, Execution execution, Body body
+) {
+    ThreadPool& pool = ThreadPool::shared();
+    grain = std::max(grain, std::size_t(1));
+
+    std::size_t chunks = 1;
+    switch (execution) {
+        case Execution::AUTOMATIC:
+            chunks = std::min(pool.concurrency(), count / grain);
+        break;
+        case Execution::SEQUENTIAL:
+            chunks = 1;
+        break;
+        case Execution::PARALLEL:
+            chunks = std::min(pool.concurrency(), count);
+        break;
+    }
+
+    if (chunks <= 1) {
+        if (count > 0) {
+            body(std::size_t(0), count);
+        }
+
+        return;
+    }
+
+    // A few ranges per thread, so that a thread that is late to start does
+    // not hold everyone up
+    if (count / chunks >= 4 * grain) {
+        chunks *= 4;
+    }
+
+    struct State {
+        std::atomic<std::size_t> next;
+        std::size_t done;
+        std::exception_ptr error;
+        std::mutex m;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+    state->next = 0;
+    state->done = 0;
+
+    const std::size_t size = (count + chunks - 1) / chunks;
+    chunks = (count + size - 1) / size;
+
+    // Helpers may start after all ranges are taken, or even after this
+    // function returns, which is why 'state' is shared and 'body' is only
+    // touched for a range that was taken
+    auto help = [state, size, count, chunks, &body]() {
+        while (true) {
+            const std::size_t chunk = state->next++;
+            if (chunk >= chunks) {
+                return;
+            }
+
+            try {
+                body(chunk * size, std::min(count, (chunk + 1) * size));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->m);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(state->m);
+            if (++state->done == chunks) {
+                state->cv.notify_all();
+            }
+        }
+    };
+
+    for (std::size_t i = 1; i < std::min(chunks, pool.concurrency()); ++i) {
+        pool.submit(help);
+    }
+    help();
+
+    std::unique_lock<std::mutex> lock(state->m);
+    state->cv.wait(lock, [&state, chunks]() {
+        return state->done == chunks;
+    });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+#endif // PARALLEL_H_INCLUDED
@@ -0,0 +1,408 @@
+#ifndef SPARSE_MATRIX_H_INCLUDED
+#define SPARSE_MATRIX_H_INCLUDED
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+#include "parallel.h"
+
+
+// Sparse matrices keep only the elements that are not value_type(), so
+// their memory and the time taken by their operations grow with the number
+// of such elements rather than with rows x columns. They come in two
+// formats:
+//
+// - CooMatrix, a list of (row, column, value) triplets in any order, which
+//   is cheap to add elements to;
+// - CsrMatrix (compressed sparse rows), which stores the elements row by
+//   row, sorted by column, and is what the arithmetic works on.
+//
+// A CooMatrix is built up and then turned into a CsrMatrix.
+
+template<class T = int>
+class CooMatrix {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+
+    struct Element {
+        size_type row;
+        size_type column;
+        value_type value;
+    };
+
+    size_type rows() const {
+        return this->_rows;
+    }
+
+    size_type columns() const {
+        return this->_columns;
+    }
+
+    const std::vector<Element>& elements() const {
+        return this->_elements;
+    }
+
+    // Elements added at the same position more than once are summed
+    void add(size_type row, size_type column, const value_type& value) {
+        if (row >= this->_rows || column >= this->_columns) {
+            throw std::out_of_range("The element is outside the matrix");
+        }
+
+        this->_elements.push_back({row, column, value});
+    }
+
+    void reserve(size_type count) {
+        this->_elements.reserve(count);
+    }
+
+    CooMatrix(size_type rows, size_type columns)
+    :
+        _rows(rows),
+        _columns(columns),
+        _elements()
+    {}
+
+private:
+    size_type _rows;
+    size_type _columns;
+    std::vector<Element> _elements;
+};
+
+template<class T = int>
+class CsrMatrix {
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using index_type = std::pair<size_type, size_type>;
+
+    size_type rows() const {
+        return this->_rows;
+    }
+
+    size_type columns() const {
+        return this->_columns;
+    }
+
+    // The number of elements stored
+    size_type nonzeros() const {
+        return this->_values.size();
+    }
+
+    // The elements of row i are [row_offsets()[i], row_offsets()[i + 1]) in
+    // column_indices() and values()
+    const std::vector<size_type>& row_offsets() const {
+        return this->_row_offsets;
+    }
+
+    const std::vector<size_type>& column_indices() const {
+        return this->_column_indices;
+    }
+
+    const std::vector<value_type>& values() const {
+        return this->_values;
+    }
+
+    // value_type() where nothing is stored
+    value_type operator[](index_type index) const {
+        const auto first = this->_column_indices.begin()
+            + this->_row_offsets[index.first];
+        const auto last = this->_column_indices.begin()
+            + this->_row_offsets[index.first + 1];
+        const auto found = std::lower_bound(first, last, index.second);
+
+        if (found == last || *found != index.second) {
+            return value_type();
+        }
+
+        return this->_values[found - this->_column_indices.begin()];
+    }
+
+    Matrix<value_type> to_dense() const {
+        Matrix<value_type> dense(this->_rows, this->_columns);
+        value_type* data = dense.data();
+
+        for (size_type i = 0; i < this->_rows; ++i) {
+            for (
+                size_type k = this->_row_offsets[i];
+                k < this->_row_offsets[i + 1];
+                ++k
+            ) {
+                data[i * dense.stride() + this->_column_indices[k]] =
+                    this->_values[k];
+            }
+        }
+
+        return dense;
+    }
+
+    CsrMatrix operator+(const CsrMatrix& other) const {
+        return this->_merge(other, Sum());
+    }
+
+    CsrMatrix operator-(const CsrMatrix& other) const {
+        return this->_merge(other, Difference());
+    }
+
+    Matrix<value_type> operator+(const Matrix<value_type>& other) const {
+        Matrix<value_type> result(other);
+        this->_add_to(result, Sum());
+
+        return result;
+    }
+
+    Matrix<value_type> operator-(const Matrix<value_type>& other) const {
+        Matrix<value_type> result(other * value_type(-1));
+        this->_add_to(result, Sum());
+
+        return result;
+    }
+
+    template<
+        class U,
+        std::enable_if_t<
+            std::is_arithmetic<U>::value || std::is_same<U, T>::value,
+            bool
+        > = true
+    >
+    CsrMatrix operator*(const U& factor) const {
+        static_assert(
+            is_exact_factor<U, value_type>::value,
+            "The factor would be narrowed to the element type"
+        );
+
+        if (factor == U()) {
+            return CsrMatrix(this->_rows, this->_columns);
+        }
+
+        CsrMatrix result(*this);
+        for (auto& value: result._values) {
+            value = value_type(value * factor);
+        }
+
+        return result;
+    }
+
+    // y = A * x, in parallel over bands of rows
+    std::vector<value_type> multiply(
+        const std::vector<value_type>& x,
+        Execution execution = Execution::AUTOMATIC
+    ) const {
+        if (x.size() != this->_columns) {
+            throw std::length_error("Matrix sizes do not match");
+        }
+
+        std::vector<value_type> y(this->_rows);
+        const size_type per_row = this->nonzeros()
+            / std::max(this->_rows, size_type(1));
+
+        parallel_for(
+            this->_rows,
+            PARALLEL_GRAIN_SIZE / std::max(per_row, size_type(1)) + 1,
+            execution,
+            [&](size_type begin, size_type end) {
+                for (size_type i = begin; i < end; ++i) {
+                    value_type dot = value_type();
+                    for (
+                        size_type k = this->_row_offsets[i];
+                        k < this->_row_offsets[i + 1];
+                        ++k
+                    ) {
+                        dot += this->_values[k] * x[this->_column_indices[k]];
+                    }
+                    y[i] = dot;
+                }
+            }
+        );
+
+        return y;
+    }
+
+    std::vector<value_type> operator*(const std::vector<value_type>& x) const {
+        return this->multiply(x);
+    }
+
+    CsrMatrix(size_type rows, size_type columns)
+    :
+        _rows(rows),
+        _columns(columns),
+        _row_offsets(rows + 1),
+        _column_indices(),
+        _values()
+    {}
+
+    // Sorts the elements by row with a counting pass, then each row by
+    // column, and sums duplicates. Elements that come to value_type() are
+    // dropped.
+    explicit CsrMatrix(const CooMatrix<value_type>& coo)
+    :
+        CsrMatrix(coo.rows(), coo.columns())
+    {
+        const auto& elements = coo.elements();
+
+        std::vector<size_type> offsets(this->_rows + 1);
+        for (const auto& element: elements) {
+            ++offsets[element.row + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        std::vector<std::pair<size_type, value_type>> sorted(elements.size());
+        std::vector<size_type> next(offsets.begin(), offsets.end() - 1);
+        for (const auto& element: elements) {
+            sorted[next[element.row]++] = {element.column, element.value};
+        }
+
+        this->_column_indices.reserve(elements.size());
+        this->_values.reserve(elements.size());
+        for (size_type i = 0; i < this->_rows; ++i) {
+            const auto first = sorted.begin() + offsets[i];
+            const auto last = sorted.begin() + offsets[i + 1];
+            std::stable_sort(first, last, [](const auto& a, const auto& b) {
+                return a.first < b.first;
+            });
+
+            for (auto element = first; element != last; ++element) {
+                if (
+                    this->_column_indices.size() > this->_row_offsets[i]
+                    && this->_column_indices.back() == element->first
+                ) {
+                    this->_values.back() += element->second;
+                } else {
+                    this->_column_indices.push_back(element->first);
+                    this->_values.push_back(element->second);
+                }
+            }
+
+            // Elements that are, or sum to, value_type() are not stored
+            size_type kept = this->_row_offsets[i];
+            for (size_type k = kept; k < this->_values.size(); ++k) {
+                if (this->_values[k] != value_type()) {
+                    this->_column_indices[kept] = this->_column_indices[k];
+                    this->_values[kept] = std::move(this->_values[k]);
+                    ++kept;
+                }
+            }
+            this->_column_indices.resize(kept);
+            this->_values.resize(kept);
+            this->_row_offsets[i + 1] = kept;
+        }
+    }
+
+    // Keeps the elements that are not value_type()
+    explicit CsrMatrix(const Matrix<value_type>& dense)
+    :
+        CsrMatrix(dense.rows(), dense.columns())
+    {
+        for (size_type i = 0; i < this->_rows; ++i) {
+            for (size_type j = 0; j < this->_columns; ++j) {
+                const value_type& value = dense(i, j);
+                if (value != value_type()) {
+                    this->_column_indices.push_back(j);
+                    this->_values.push_back(value);
+                }
+            }
+            this->_row_offsets[i + 1] = this->_values.size();
+        }
+    }
+
+private:
+    // Merges the sorted rows of both matrices, like std::merge()
+    template<class Operation>
+    CsrMatrix _merge(const CsrMatrix& other, Operation operation) const {
+        if (
+            this->_rows != other._rows
+            ||
+            this->_columns != other._columns
+        ) {
+            throw std::length_error("Matrix sizes do not match");
+        }
+
+        CsrMatrix result(this->_rows, this->_columns);
+        result._column_indices.reserve(this->nonzeros() + other.nonzeros());
+        result._values.reserve(this->nonzeros() + other.nonzeros());
+
+        for (size_type i = 0; i < this->_rows; ++i) {
+            size_type a = this->_row_offsets[i];
+            size_type b = other._row_offsets[i];
+            const size_type a_end = this->_row_offsets[i + 1];
+            const size_type b_end = other._row_offsets[i + 1];
+
+            while (a < a_end || b < b_end) {
+                const size_type column = std::min(
+                    a < a_end ? this->_column_indices[a] : this->_columns,
+                    b < b_end ? other._column_indices[b] : other._columns
+                );
+                const bool in_a = a < a_end
+                    && this->_column_indices[a] == column;
+                const bool in_b = b < b_end
+                    && other._column_indices[b] == column;
+
+                const value_type value = operation(
+                    in_a ? this->_values[a++] : value_type(),
+                    in_b ? other._values[b++] : value_type()
+                );
+
+                // Elements that cancel out are not stored
+                if (value != value_type()) {
+                    result._column_indices.push_back(column);
+                    result._values.push_back(value);
+                }
+            }
+            result._row_offsets[i + 1] = result._values.size();
+        }
+
+        return result;
+    }
+
+    // dense = operation(dense, *this) at the stored positions
+    template<class Operation>
+    void _add_to(Matrix<value_type>& dense, Operation operation) const {
+        if (
+            this->_rows != dense.rows()
+            ||
+            this->_columns != dense.columns()
+        ) {
+            throw std::length_error("Matrix sizes do not match");
+        }
+
+        value_type* data = dense.data();
+        for (size_type i = 0; i < this->_rows; ++i) {
+            for (
+                size_type k = this->_row_offsets[i];
+                k < this->_row_offsets[i + 1];
+                ++k
+            ) {
+                value_type& element = data[
+                    i * dense.stride() + this->_column_indices[k]
+                ];
+                element = operation(element, this->_values[k]);
+            }
+        }
+    }
+
+    size_type _rows;
+    size_type _columns;
+    std::vector<size_type> _row_offsets;
+    std::vector<size_type> _column_indices;
+    std::vector<value_type> _values;
+};
+
+// dense + sparse and dense - sparse touch the stored elements only, after
+// copying the dense operand
+template<class T>
+Matrix<T> operator+(const Matrix<T>& dense, const CsrMatrix<T>& sparse) {
+    return sparse + dense;
+}
+
+template<class T>
+Matrix<T> operator-(const Matrix<T>& dense, const CsrMatrix<T>& sparse) {
+    return dense + sparse * T(-1);
+}
+
+#endif // SPARSE_MATRIX_H_INCLUDED
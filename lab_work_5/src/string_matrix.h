@@ -0,0 +1,333 @@
+#ifndef STRING_MATRIX_H_INCLUDED
+#define STRING_MATRIX_H_INCLUDED
+
+#include <algorithm>
+#include <functional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+#include "parallel.h"
+#include "text_writer.h"
+
+
+// A matrix of strings that keeps the characters of all its strings back to
+// back in a single buffer, the arena, and each element as an offset and a
+// length into it. Building or copying it takes a few allocations however
+// many elements there are, where a Matrix<std::string> takes one for every
+// string too long for the small string buffer, and an element takes 16
+// bytes rather than sizeof(std::string).
+//
+// Elements are read as std::string_view and are set rather than assigned
+// through a reference. The arena is only appended to, so the bytes of a
+// replaced element stay there until compact().
+//
+// With Interning::ENABLED, equal strings are stored once, which suits
+// tables of labels drawn from a small set of values.
+
+enum class Interning {DISABLED, ENABLED};
+
+class StringMatrix {
+public:
+    using value_type = std::string_view;
+    using size_type = std::size_t;
+    using index_type = std::pair<size_type, size_type>;
+
+    size_type rows() const {
+        return this->_rows;
+    }
+
+    size_type columns() const {
+        return this->_columns;
+    }
+
+    Interning interning() const {
+        return this->_interning;
+    }
+
+    // The number of characters in the arena, replaced elements included
+    size_type arena_size() const {
+        return this->_characters.size();
+    }
+
+    // Makes room for 'characters' more characters in the arena
+    void reserve(size_type characters) {
+        this->_characters.reserve(this->_characters.size() + characters);
+    }
+
+    // The view is valid until the arena grows
+    value_type operator()(size_type row, size_type column) const {
+        return this->_view(this->_cells[row * this->_columns + column]);
+    }
+
+    value_type operator[](index_type index) const {
+        return (*this)(index.first, index.second);
+    }
+
+    void set(size_type row, size_type column, value_type value) {
+        if (row >= this->_rows || column >= this->_columns) {
+            throw std::out_of_range("The element is outside the matrix");
+        }
+
+        this->_cells[row * this->_columns + column] = this->_store(value);
+    }
+
+    // Rebuilds the arena with the current elements only
+    void compact() {
+        StringMatrix result(this->_rows, this->_columns, this->_interning);
+        if (this->_interning == Interning::DISABLED) {
+            result.reserve(this->_total_length());
+        }
+
+        for (size_type k = 0; k < this->_cells.size(); ++k) {
+            result._cells[k] = result._store(this->_view(this->_cells[k]));
+        }
+
+        *this = std::move(result);
+    }
+
+    Matrix<std::string> to_dense() const {
+        Matrix<std::string> dense(this->_rows, this->_columns);
+
+        for (size_type i = 0; i < this->_rows; ++i) {
+            for (size_type j = 0; j < this->_columns; ++j) {
+                const value_type value = (*this)(i, j);
+                dense[std::make_pair(i, j)].assign(value.data(), value.size());
+            }
+        }
+
+        return dense;
+    }
+
+    // Elementwise concatenation. The lengths of the results are added up
+    // first, so the arena of the result is allocated once, and then the
+    // characters are copied in parallel over bands of rows. The result
+    // does not intern.
+    StringMatrix concatenate(
+        const StringMatrix& other, Execution execution = Execution::AUTOMATIC
+    ) const {
+        if (
+            this->_rows != other._rows
+            ||
+            this->_columns != other._columns
+        ) {
+            throw std::length_error("Matrix sizes do not match");
+        }
+
+        StringMatrix result(this->_rows, this->_columns);
+        size_type total = 0;
+        for (size_type k = 0; k < this->_cells.size(); ++k) {
+            const size_type length = this->_cells[k].length
+                + other._cells[k].length;
+            result._cells[k] = {total, length};
+            total += length;
+        }
+        result._characters.resize(total);
+
+        const size_type per_row = total / std::max(this->_rows, size_type(1));
+
+        parallel_for(
+            this->_rows,
+            PARALLEL_GRAIN_SIZE / std::max(per_row, size_type(1)) + 1,
+            execution,
+            [&](size_type begin, size_type end) {
+                for (
+                    size_type k = begin * this->_columns;
+                    k < end * this->_columns;
+                    ++k
+                ) {
+                    const value_type left = this->_view(this->_cells[k]);
+                    const value_type right = other._view(other._cells[k]);
+                    char* out = result._characters.data()
+                        + result._cells[k].offset;
+
+                    std::copy(left.begin(), left.end(), out);
+                    std::copy(right.begin(), right.end(), out + left.size());
+                }
+            }
+        );
+
+        return result;
+    }
+
+    StringMatrix operator+(const StringMatrix& other) const {
+        return this->concatenate(other);
+    }
+
+    // A matrix of empty strings
+    StringMatrix(
+        size_type rows,
+        size_type columns,
+        Interning interning = Interning::DISABLED
+    )
+    :
+        _characters(),
+        _cells(rows * columns),
+        _table(),
+        _interned(0),
+        _rows(rows),
+        _columns(columns),
+        _interning(interning)
+    {}
+
+    // Without interning, the lengths are added up first, so the arena is
+    // allocated once
+    explicit StringMatrix(
+        const Matrix<std::string>& dense,
+        Interning interning = Interning::DISABLED
+    )
+    :
+        StringMatrix(dense.rows(), dense.columns(), interning)
+    {
+        if (interning == Interning::DISABLED) {
+            size_type total = 0;
+            for (size_type i = 0; i < this->_rows; ++i) {
+                for (size_type j = 0; j < this->_columns; ++j) {
+                    total += dense(i, j).size();
+                }
+            }
+            this->reserve(total);
+        }
+
+        for (size_type i = 0; i < this->_rows; ++i) {
+            for (size_type j = 0; j < this->_columns; ++j) {
+                this->_cells[i * this->_columns + j] = this->_store(
+                    dense(i, j)
+                );
+            }
+        }
+    }
+
+private:
+    struct Cell {
+        size_type offset;
+        size_type length;
+    };
+
+    // The offset of a slot of the interning table that holds no string
+    static constexpr size_type _FREE_SLOT = size_type(-1);
+
+    value_type _view(const Cell& cell) const {
+        return value_type(
+            this->_characters.data() + cell.offset, cell.length
+        );
+    }
+
+    size_type _total_length() const {
+        size_type total = 0;
+        for (const Cell& cell: this->_cells) {
+            total += cell.length;
+        }
+
+        return total;
+    }
+
+    // Where 'value' is kept in the arena, after adding it if need be
+    Cell _store(value_type value) {
+        if (value.empty()) {
+            return {0, 0};
+        }
+
+        // A view of the arena itself is already there, and appending it
+        // could move it
+        const char* begin = this->_characters.data();
+        const char* end = begin + this->_characters.size();
+        if (
+            std::greater_equal<const char*>()(value.data(), begin)
+            &&
+            std::less<const char*>()(value.data(), end)
+        ) {
+            return {size_type(value.data() - begin), value.size()};
+        }
+
+        if (this->_interning == Interning::DISABLED) {
+            return this->_append(value);
+        }
+
+        if ((this->_interned + 1) * 2 > this->_table.size()) {
+            this->_grow_table();
+        }
+
+        size_type slot = this->_find_slot(value);
+        if (this->_table[slot].offset == _FREE_SLOT) {
+            this->_table[slot] = this->_append(value);
+            ++this->_interned;
+        }
+
+        return this->_table[slot];
+    }
+
+    Cell _append(value_type value) {
+        const Cell cell = {this->_characters.size(), value.size()};
+        this->_characters.insert(
+            this->_characters.end(), value.begin(), value.end()
+        );
+
+        return cell;
+    }
+
+    // The slot of the interning table that holds 'value', or the free slot
+    // it goes to. The table is open-addressed with linear probing and is
+    // kept at most half full.
+    size_type _find_slot(value_type value) const {
+        const size_type mask = this->_table.size() - 1;
+        size_type slot = std::hash<value_type>()(value) & mask;
+
+        while (
+            this->_table[slot].offset != _FREE_SLOT
+            &&
+            this->_view(this->_table[slot]) != value
+        ) {
+            slot = (slot + 1) & mask;
+        }
+
+        return slot;
+    }
+
+    void _grow_table() {
+        std::vector<Cell> table(
+            std::max(this->_table.size() * 2, size_type(16)),
+            Cell{_FREE_SLOT, 0}
+        );
+        table.swap(this->_table);
+
+        for (const Cell& cell: table) {
+            if (cell.offset != _FREE_SLOT) {
+                this->_table[this->_find_slot(this->_view(cell))] = cell;
+            }
+        }
+    }
+
+    std::vector<char> _characters;
+    std::vector<Cell> _cells;
+    std::vector<Cell> _table;
+    size_type _interned;
+    size_type _rows;
+    size_type _columns;
+    Interning _interning;
+};
+
+// Printed the way a Matrix<std::string> is
+inline std::ostream& operator<<(
+    std::ostream& out, const StringMatrix& matrix
+) {
+    TextWriter writer(out);
+
+    for (std::size_t i = 0; i < matrix.rows(); ++i) {
+        for (std::size_t j = 0; j < matrix.columns(); ++j) {
+            writer.write(matrix(i, j));
+            if (j < matrix.columns() - 1) {
+                writer.write(" | ");
+            }
+        }
+        writer.write('\n');
+    }
+
+    return out;
+}
+
+#endif // STRING_MATRIX_H_INCLUDED
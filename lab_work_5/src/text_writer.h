@@ -0,0 +1,173 @@
+#ifndef TEXT_WRITER_H_INCLUDED
+#define TEXT_WRITER_H_INCLUDED
+
+#include <charconv>
+#include <cstddef>
+#include <ios>
+#include <locale>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+
+// Types that are written and read as numbers. Character types are not:
+// streams print them as characters.
+template<class T>
+struct is_text_number
+    : std::integral_constant<
+        bool,
+        std::is_floating_point<T>::value
+        || (
+            std::is_integral<T>::value
+            && !std::is_same<T, bool>::value
+            && !std::is_same<T, char>::value
+            && !std::is_same<T, signed char>::value
+            && !std::is_same<T, unsigned char>::value
+            && !std::is_same<T, wchar_t>::value
+            && !std::is_same<T, char16_t>::value
+            && !std::is_same<T, char32_t>::value
+        )
+    >
+{};
+
+// The notation 'stream' is set to print floating point numbers in
+inline std::chars_format float_format(const std::ios_base& stream) {
+    switch (stream.flags() & std::ios_base::floatfield) {
+        case std::ios_base::fixed:
+            return std::chars_format::fixed;
+        case std::ios_base::scientific:
+            return std::chars_format::scientific;
+        default:
+            return std::chars_format::general;
+    }
+}
+
+// Whether 'stream' prints numbers the way to_chars() writes them: in
+// decimal, with no flags for signs, bases, points or letter case, no field
+// width and the classic locale. Otherwise the stream has to format them.
+inline bool is_plain_format(const std::ios_base& stream) {
+    const std::ios_base::fmtflags flags = stream.flags();
+    const std::ios_base::fmtflags base = flags & std::ios_base::basefield;
+    const std::ios_base::fmtflags decorations = std::ios_base::showpos
+        | std::ios_base::showbase
+        | std::ios_base::showpoint
+        | std::ios_base::uppercase;
+    const std::ios_base::fmtflags hexfloat = std::ios_base::fixed
+        | std::ios_base::scientific;
+
+    return (base == std::ios_base::dec || base == std::ios_base::fmtflags())
+        && !(flags & decorations)
+        && (flags & std::ios_base::floatfield) != hexfloat
+        && stream.width() == 0
+        && stream.getloc() == std::locale::classic();
+}
+
+// Formats text into a block of memory with std::to_chars() and hands the
+// block to the stream in one write() when it fills up, and when the writer
+// is flushed or destroyed. The stream itself is never flushed.
+class TextWriter {
+public:
+    static constexpr std::size_t BUFFER_SIZE = std::size_t(64) << 10;
+
+    void write(std::string_view text) {
+        if (text.size() > BUFFER_SIZE - this->_size) {
+            this->flush();
+            if (text.size() > BUFFER_SIZE) {
+                this->_out.write(text.data(), text.size());
+
+                return;
+            }
+        }
+
+        text.copy(this->_buffer.get() + this->_size, text.size());
+        this->_size += text.size();
+    }
+
+    void write(char c) {
+        if (this->_size == BUFFER_SIZE) {
+            this->flush();
+        }
+
+        this->_buffer[this->_size++] = c;
+    }
+
+    // Integers in decimal, floating point numbers in the shortest form that
+    // reads back as the same number
+    template<class T>
+    void write_number(T value) {
+        this->_write_number([value](char* first, char* last) {
+            return std::to_chars(first, last, value);
+        });
+    }
+
+    // Floating point numbers like printf() would with 'format' and
+    // 'precision'
+    template<class T>
+    void write_number(T value, std::chars_format format, int precision) {
+        this->_write_number([=](char* first, char* last) {
+            return std::to_chars(first, last, value, format, precision);
+        });
+    }
+
+    void flush() {
+        this->_out.write(this->_buffer.get(), this->_size);
+        this->_size = 0;
+    }
+
+    explicit TextWriter(std::ostream& out)
+    :
+        _out(out),
+        _buffer(new char[BUFFER_SIZE]),
+        _size(0)
+    {}
+
+    TextWriter(const TextWriter& other) = delete;
+    TextWriter& operator=(const TextWriter& other) = delete;
+
+    ~TextWriter() {
+        this->flush();
+    }
+
+private:
+    // Formats straight into the buffer, and into an empty one if that does
+    // not fit. Only a huge precision can outgrow an empty buffer, in which
+    // case the number is formatted on the heap.
+    template<class Format>
+    void _write_number(Format format) {
+        std::to_chars_result result = format(
+            this->_buffer.get() + this->_size,
+            this->_buffer.get() + BUFFER_SIZE
+        );
+        if (result.ec == std::errc()) {
+            this->_size = result.ptr - this->_buffer.get();
+
+            return;
+        }
+
+        this->flush();
+        result = format(this->_buffer.get(), this->_buffer.get() + BUFFER_SIZE);
+        if (result.ec == std::errc()) {
+            this->_size = result.ptr - this->_buffer.get();
+
+            return;
+        }
+
+        for (std::size_t size = 2 * BUFFER_SIZE; ; size *= 2) {
+            std::unique_ptr<char[]> text(new char[size]);
+            result = format(text.get(), text.get() + size);
+            if (result.ec == std::errc()) {
+                this->_out.write(text.get(), result.ptr - text.get());
+
+                return;
+            }
+        }
+    }
+
+    std::ostream& _out;
+    std::unique_ptr<char[]> _buffer;
+    std::size_t _size;
+};
+
+#endif // TEXT_WRITER_H_INCLUDED
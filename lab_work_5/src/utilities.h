@@ -1,14 +1,81 @@
 #ifndef UTILITIES_H_INCLUDED
 #define UTILITIES_H_INCLUDED
 
+#include <cstddef>
+#include <new>
+
 template<class T>
-T sum(const T& a, const T& b) {
+constexpr T sum(const T& a, const T& b) {
     return a + b;
 }
 
 template<class T>
-T difference(const T& a, const T& b) {
+constexpr T difference(const T& a, const T& b) {
     return a - b;
 }
 
-#endif // UTILITIES_H_INCLUDED
\ No newline at end of file
+// sum() and difference() as function objects, so that the compiler can
+// inline them wherever they are passed
+struct Sum {
+    template<class T>
+    constexpr T operator()(const T& a, const T& b) const {
+        return sum(a, b);
+    }
+};
+
+struct Difference {
+    template<class T>
+    constexpr T operator()(const T& a, const T& b) const {
+        return difference(a, b);
+    }
+};
+
+// Size of a cache line, which is also the width of the widest SIMD registers
+// (AVX-512) in bytes
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+// An allocator that places every block at an 'Alignment'-byte boundary
+template<class T, std::size_t Alignment = CACHE_LINE_SIZE>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<class U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(
+            ::operator new(n * sizeof(T), std::align_val_t(Alignment))
+        );
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    AlignedAllocator() = default;
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+    {}
+};
+
+template<class T, class U, std::size_t Alignment>
+bool operator==(
+    const AlignedAllocator<T, Alignment>&,
+    const AlignedAllocator<U, Alignment>&
+) {
+    return true;
+}
+
+template<class T, class U, std::size_t Alignment>
+bool operator!=(
+    const AlignedAllocator<T, Alignment>&,
+    const AlignedAllocator<U, Alignment>&
+) {
+    return false;
+}
+
+#endif // UTILITIES_H_INCLUDED